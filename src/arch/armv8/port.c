@@ -4,13 +4,35 @@
 #include <sysregs.h>
 #include <gic.h>
 #include <irq.h>
+#include <task.h>
 
 static uint64_t timer_step = 0;
 
+#if configUSE_TICKLESS_IDLE == 2
+// Maximum number of ticks that can be suppressed without overflowing the comparator computation
+static TickType_t max_suppressed_ticks = 0;
+#endif
+
 void FreeRTOS_ClearTickInterrupt(){
     sysreg_cntv_tval_el0_write(timer_step);
 }
 
+void FreeRTOS_MaskTickInterrupt(){
+    sysreg_cntv_ctl_el0_write(3); // enable timer, mask its interrupt
+}
+
+uint64_t FreeRTOS_UnmaskTickInterrupt(){
+    // Ticks that should have happened since the masked tick (programmed by the last tick interrupt)
+    uint64_t next_tick = sysreg_cntv_cval_el0_read();
+    uint64_t current_time = sysreg_cntvct_el0_read();
+    uint64_t missed_ticks = current_time >= next_tick ? (current_time - next_tick) / timer_step + 1 : 0;
+
+    // Next tick where it would have been without masking
+    sysreg_cntv_cval_el0_write(next_tick + missed_ticks * timer_step);
+    sysreg_cntv_ctl_el0_write(1); // enable timer
+    return missed_ticks;
+}
+
 static void tick_handler_wrapper(unsigned id) {
     FreeRTOS_Tick_Handler();
 }
@@ -24,7 +46,68 @@ void FreeRTOS_SetupTickInterrupt(){
     timer_step = freq / configTICK_RATE_HZ;
     sysreg_cntv_tval_el0_write(timer_step);
     sysreg_cntv_ctl_el0_write(1); // enable timer
+
+#if configUSE_TICKLESS_IDLE == 2
+    max_suppressed_ticks = (1ULL << 62) / timer_step;
+#endif
+}
+
+#if configUSE_TICKLESS_IDLE == 2
+/*
+ * Tickless idle: instead of ticking while nothing is ready, the virtual timer is
+ * programmed once at the expected wake up (delayed task, timer daemon...). Periodic
+ * releases and the PREM end of low priority are on the physical timer and wake up the
+ * core as well.
+ * If something else wakes the core up before, the elapsed ticks are counted and the
+ * next tick is programmed.
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    if (xExpectedIdleTime > max_suppressed_ticks)
+    {
+        xExpectedIdleTime = max_suppressed_ticks;
+    }
+
+    // Mask IRQs, a pending interrupt still wakes wfi up
+    __asm volatile("msr daifset, #2" ::: "memory");
+    __asm volatile("isb");
+
+    // Time of the next tick, as programmed by the last tick interrupt
+    uint64_t next_tick = sysreg_cntv_cval_el0_read();
+
+    // Something became ready in the meantime
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+    {
+        __asm volatile("msr daifclr, #2" ::: "memory");
+        __asm volatile("isb");
+        return;
+    }
+
+    // One shot at the last expected tick
+    uint64_t wakeup = next_tick + (xExpectedIdleTime - 1) * timer_step;
+    sysreg_cntv_cval_el0_write(wakeup);
+    __asm volatile("dsb sy");
+    __asm volatile("wfi");
+    __asm volatile("isb");
+
+    uint64_t current_time = sysreg_cntvct_el0_read();
+    if (current_time >= wakeup)
+    {
+        // Woken up by the timer, the tick interrupt is pending and will count the last tick
+        vTaskStepTick(xExpectedIdleTime - 1);
+    }
+    else
+    {
+        // Woken up by another interrupt, count the complete ticks and program the next one
+        TickType_t completed_ticks = current_time >= next_tick ? (current_time - next_tick) / timer_step + 1 : 0;
+        vTaskStepTick(completed_ticks);
+        sysreg_cntv_cval_el0_write(next_tick + completed_ticks * timer_step);
+    }
+
+    __asm volatile("msr daifclr, #2" ::: "memory");
+    __asm volatile("isb");
 }
+#endif
 
 void vApplicationIRQHandler(uint32_t ulICCIAR){ 
     irq_handle(ulICCIAR);
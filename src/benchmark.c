@@ -3,183 +3,297 @@
 #include <task.h>
 #include <stdio.h>
 #include <generic_timer.h>
+#include <result_channel.h>
+#include <histogram.h>
 
-// Min, Max, Average
-uint64_t sum = 0;
-uint64_t min = -1;
-uint64_t max = 0;
-uint64_t average = 0;
+// Percentiles to print (in thousandths of percent, cf. histogram.h)
+const uint64_t default_percentiles[] = {PERCENTILE(50), PERCENTILE(90), PERCENTILE(99), PERCENTILE(99.9)};
 
-// Last measured time
-uint64_t last_measured_time = 0;
+// Context used by the functions without context
+struct benchmark_ctx default_benchmark;
 
-// Benchmark config
-char *bench_name;
-int nanotime;
-int display;
-
-int test_counter = 0;
-
-uint64_t base_frequency;
-
-uint64_t get_minimum_time()
+/* Integer square root (rounded down) */
+uint64_t isqrt(unsigned __int128 value)
 {
-    int min_time;
-    if (nanotime)
+    unsigned __int128 root = 0;
+    unsigned __int128 bit = (unsigned __int128)1 << 126;
+
+    while (bit > value)
     {
-        min_time = pdSYSTICK_TO_NS(base_frequency, min);
+        bit >>= 2;
     }
-    else
+
+    while (bit != 0)
     {
-        min_time = pdSYSTICK_TO_US(base_frequency, min);
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
     }
-    return min_time;
+
+    return (uint64_t)root;
 }
 
-uint64_t get_maximum_time()
+/* Converts ticks in the benchmark unit */
+uint64_t ticks_to_time(struct benchmark_ctx *ctx, uint64_t ticks)
 {
-    int max_time;
-    if (nanotime)
-    {
-        max_time = pdSYSTICK_TO_NS(base_frequency, max);
-    }
-    else
+    if (ctx->nanotime)
     {
-        max_time = pdSYSTICK_TO_US(base_frequency, max);
+        return generic_timer_systick_to_ns(ticks);
     }
-    return max_time;
+    return generic_timer_systick_to_us(ticks);
 }
 
-uint64_t get_average_time()
+uint64_t benchmark_ctx_get_minimum_time(struct benchmark_ctx *ctx)
 {
-    average = sum / test_counter;
-    int average_time;
-    if (nanotime)
-    {
-        average_time = pdSYSTICK_TO_NS(base_frequency, average);
-    }
-    else
+    // Nothing measured, then 0
+    if (ctx->histogram.total == 0)
     {
-        average_time = pdSYSTICK_TO_US(base_frequency, average);
+        return 0;
     }
-    return average_time;
+
+    return ticks_to_time(ctx, ctx->histogram.min);
 }
 
-void run_benchmark(benchmark_t benchmark_code, void *benchmark_argument)
+uint64_t benchmark_ctx_get_maximum_time(struct benchmark_ctx *ctx)
 {
-    // Taking time before and after code execution
-    uint64_t startTime = generic_timer_read_counter();
-    benchmark_code(benchmark_argument);
-    uint64_t endTime = generic_timer_read_counter();
-
-    // Compute execution time
-    uint64_t elapsedTime = endTime - startTime;
+    return ticks_to_time(ctx, ctx->histogram.max);
+}
 
-    // Test for minimum
-    if (min == -1 || elapsedTime < min)
+uint64_t benchmark_ctx_get_average_time(struct benchmark_ctx *ctx)
+{
+    if (ctx->histogram.total == 0)
     {
-        min = elapsedTime;
+        return 0;
     }
 
-    // Test for maximum
-    if (elapsedTime > max)
+    return ticks_to_time(ctx, ctx->histogram.sum / ctx->histogram.total);
+}
+
+uint64_t benchmark_ctx_get_standard_deviation(struct benchmark_ctx *ctx)
+{
+    if (ctx->histogram.total == 0)
     {
-        max = elapsedTime;
+        return 0;
     }
 
-    // Add elapsed time with other times
-    sum += elapsedTime;
-    test_counter += 1;
+    // n².Variance = n.sum(X²) - sum(X)², exact (truncating the means first cancels out tight distributions)
+    unsigned __int128 total = ctx->histogram.total;
+    unsigned __int128 sum = ctx->histogram.sum;
+    unsigned __int128 total_square_sum = total * ctx->square_sum;
+    unsigned __int128 deviation_sum = total_square_sum > sum * sum ? total_square_sum - sum * sum : 0;
+
+    // Its root is n.stddev, divided by n after the conversion to keep the fraction of tick
+    return ticks_to_time(ctx, isqrt(deviation_sum)) / ctx->histogram.total;
+}
+
+uint64_t benchmark_ctx_get_percentile_time(struct benchmark_ctx *ctx, uint64_t percentile)
+{
+    return ticks_to_time(ctx, histogram_get_percentile(&ctx->histogram, percentile));
+}
+
+uint64_t benchmark_ctx_get_last_measured_time(struct benchmark_ctx *ctx)
+{
+    return generic_timer_systick_to_ns(ctx->last_elapsed_time);
+}
+
+void benchmark_ctx_set_percentiles(struct benchmark_ctx *ctx, const uint64_t *benchmark_percentiles, int benchmark_percentile_number)
+{
+    ctx->percentiles = benchmark_percentiles;
+    ctx->percentile_number = benchmark_percentile_number;
+}
+
+void benchmark_ctx_record(struct benchmark_ctx *ctx, uint64_t elapsed_time)
+{
+    // Min, max, sum and distribution are in the histogram
+    histogram_record(&ctx->histogram, elapsed_time);
+    ctx->square_sum += (unsigned __int128)elapsed_time * elapsed_time;
+    ctx->last_elapsed_time = elapsed_time;
 
     // Print result for result array
-    uint64_t measured_time;
-    if (nanotime)
-    {
-        measured_time = pdSYSTICK_TO_NS(base_frequency, elapsedTime);
-        last_measured_time = measured_time;
-    }
-    else
+    if (ctx->display)
     {
-        measured_time = pdSYSTICK_TO_US(base_frequency, elapsedTime);
-        last_measured_time = pdSYSTICK_TO_NS(base_frequency, elapsedTime);
-    }
+#ifdef RESULT_CHANNEL
+        result_channel_write(ctx->stream, elapsed_time);
 
-    if (display)
-    {
-        printf("%ld,", measured_time);
+        // Drain before it is full (outside of the measured code)
+        if (result_channel_pending() >= RESULT_CHANNEL_CAPACITY / 2)
+        {
+            result_channel_drain();
+        }
+#else
+        printf("%ld,", ticks_to_time(ctx, elapsed_time));
+#endif
     }
 }
 
-void init_benchmark(char *benchmark_name, int use_nano, int display_intermediate)
+void benchmark_ctx_run(struct benchmark_ctx *ctx, benchmark_t benchmark_code, void *benchmark_argument)
+{
+    // Taking time before and after code execution
+    uint64_t startTime = generic_timer_read_counter();
+    benchmark_code(benchmark_argument);
+    uint64_t endTime = generic_timer_read_counter();
+
+    // Compute execution time and record it
+    benchmark_ctx_record(ctx, endTime - startTime);
+}
+
+void benchmark_ctx_init(struct benchmark_ctx *ctx, char *benchmark_name, int use_nano, int display_intermediate)
 {
     // Set benchmark name
     if (benchmark_name == NULL)
     {
-        bench_name = "";
+        ctx->name = "";
     }
     else
     {
-        bench_name = benchmark_name;
+        ctx->name = benchmark_name;
     }
 
     // Set nanotime
-    nanotime = use_nano;
-    display = display_intermediate;
-
-    // Reset min, max and average
-    min = -1;
-    max = 0;
-    sum = 0;
-    average = 0;
+    ctx->nanotime = use_nano;
+    ctx->display = display_intermediate;
 
-    // Reset last measured time
-    last_measured_time = 0;
+    // Reset measures
+    histogram_reset(&ctx->histogram);
+    ctx->square_sum = 0;
+    ctx->last_elapsed_time = 0;
 
-    // Reset test counter
-    test_counter = 0;
+    // Default percentiles
+    ctx->percentiles = default_percentiles;
+    ctx->percentile_number = sizeof(default_percentiles) / sizeof(uint64_t);
 
-    // Get base frequency
-    base_frequency = generic_timer_get_freq();
+    // Get base frequency (also computes the conversions outside of measures)
+    generic_timer_get_freq();
 
-    if (display)
+    if (ctx->display)
     {
-        if (nanotime)
+#ifdef RESULT_CHANNEL
+        // Values go in the channel (in systicks), only say where
+        char array_name[64];
+        snprintf(array_name, sizeof(array_name), ctx->nanotime ? "elapsed_time_array%s_ns" : "elapsed_time_array%s", ctx->name);
+        ctx->stream = result_channel_open(array_name);
+        printf("# %s in result channel stream %ld\n", array_name, ctx->stream);
+#else
+        if (ctx->nanotime)
         {
-            printf("elapsed_time_array%s_ns = [", bench_name);
+            printf("elapsed_time_array%s_ns = [", ctx->name);
         }
         else
         {
-            printf("elapsed_time_array%s = [", bench_name);
+            printf("elapsed_time_array%s = [", ctx->name);
         }
+#endif
     }
 }
 
-uint64_t get_last_measured_time()
+void benchmark_ctx_report(struct benchmark_ctx *ctx)
 {
-    return last_measured_time;
-}
-
-void print_benchmark_results()
-{
-    if (display)
+    if (ctx->display)
     {
+#ifdef RESULT_CHANNEL
+        result_channel_drain();
+#else
         printf("]\n"); // End elapsed time array
+#endif
     }
-    
-    if (nanotime)
+
+    if (ctx->nanotime)
     {
-        printf("min%s_ns = %llu # ns\n", bench_name, get_minimum_time());
-        printf("max%s_ns = %llu # ns\n", bench_name, get_maximum_time());
-        printf("int_average%s_ns = %llu # ns\n", bench_name, get_average_time());
+        printf("min%s_ns = %llu # ns\n", ctx->name, benchmark_ctx_get_minimum_time(ctx));
+        printf("max%s_ns = %llu # ns\n", ctx->name, benchmark_ctx_get_maximum_time(ctx));
+        printf("int_average%s_ns = %llu # ns\n", ctx->name, benchmark_ctx_get_average_time(ctx));
+        printf("stddev%s_ns = %llu # ns\n", ctx->name, benchmark_ctx_get_standard_deviation(ctx));
     }
     else
     {
-        printf("min%s = %llu # us\n", bench_name, get_minimum_time());
-        printf("max%s = %llu # us\n", bench_name, get_maximum_time());
-        printf("int_average%s = %llu # us\n", bench_name, get_average_time());
+        printf("min%s = %llu # us\n", ctx->name, benchmark_ctx_get_minimum_time(ctx));
+        printf("max%s = %llu # us\n", ctx->name, benchmark_ctx_get_maximum_time(ctx));
+        printf("int_average%s = %llu # us\n", ctx->name, benchmark_ctx_get_average_time(ctx));
+        printf("stddev%s = %llu # us\n", ctx->name, benchmark_ctx_get_standard_deviation(ctx));
+    }
+
+    // Percentiles, the name is p + the percentile without dot (p99.9 -> p999)
+    for (int index = 0; index < ctx->percentile_number; index++)
+    {
+        uint64_t percentile = ctx->percentiles[index];
+        uint64_t decimals = percentile % PERCENTILE(1);
+        char percentile_name[16];
+        int length = sprintf(percentile_name, "p%llu", percentile / PERCENTILE(1));
+        while (decimals != 0)
+        {
+            decimals *= 10;
+            length += sprintf(percentile_name + length, "%llu", decimals / PERCENTILE(1));
+            decimals %= PERCENTILE(1);
+        }
+
+        if (ctx->nanotime)
+        {
+            printf("%s%s_ns = %llu # ns\n", percentile_name, ctx->name, benchmark_ctx_get_percentile_time(ctx, percentile));
+        }
+        else
+        {
+            printf("%s%s = %llu # us\n", percentile_name, ctx->name, benchmark_ctx_get_percentile_time(ctx, percentile));
+        }
     }
 }
 
+uint64_t get_minimum_time()
+{
+    return benchmark_ctx_get_minimum_time(&default_benchmark);
+}
+
+uint64_t get_maximum_time()
+{
+    return benchmark_ctx_get_maximum_time(&default_benchmark);
+}
+
+uint64_t get_average_time()
+{
+    return benchmark_ctx_get_average_time(&default_benchmark);
+}
+
+uint64_t get_standard_deviation()
+{
+    return benchmark_ctx_get_standard_deviation(&default_benchmark);
+}
+
+uint64_t get_percentile_time(uint64_t percentile)
+{
+    return benchmark_ctx_get_percentile_time(&default_benchmark, percentile);
+}
+
+void set_benchmark_percentiles(const uint64_t *benchmark_percentiles, int benchmark_percentile_number)
+{
+    benchmark_ctx_set_percentiles(&default_benchmark, benchmark_percentiles, benchmark_percentile_number);
+}
+
+void run_benchmark(benchmark_t benchmark_code, void *benchmark_argument)
+{
+    benchmark_ctx_run(&default_benchmark, benchmark_code, benchmark_argument);
+}
+
+void init_benchmark(char *benchmark_name, int use_nano, int display_intermediate)
+{
+    benchmark_ctx_init(&default_benchmark, benchmark_name, use_nano, display_intermediate);
+}
+
+uint64_t get_last_measured_time()
+{
+    return benchmark_ctx_get_last_measured_time(&default_benchmark);
+}
+
+void print_benchmark_results()
+{
+    benchmark_ctx_report(&default_benchmark);
+}
+
 void start_benchmark()
 {
     printf("# Benchmark start\n");
@@ -188,4 +302,4 @@ void start_benchmark()
 void end_benchmark()
 {
     printf("# Benchmark end\n");
-}
\ No newline at end of file
+}
@@ -0,0 +1,240 @@
+#include <cache.h>
+#include <prefetch.h>
+#include <residency.h>
+
+// CLIDR_EL1 fields
+#define CLIDR_CTYPE_WIDTH 3
+#define CLIDR_CTYPE_MASK 0x7
+
+// CCSIDR_EL1 fields (the 64-bit format is used with FEAT_CCIDX)
+#define CCSIDR_LINE_SIZE_MASK 0x7
+#define CCSIDR_ASSOCIATIVITY_OFF 3
+#define CCSIDR_ASSOCIATIVITY_MASK 0x3FF
+#define CCSIDR_NUM_SETS_OFF 13
+#define CCSIDR_NUM_SETS_MASK 0x7FFF
+#define CCSIDR_CCIDX_ASSOCIATIVITY_MASK 0x1FFFFF
+#define CCSIDR_CCIDX_NUM_SETS_OFF 32
+#define CCSIDR_CCIDX_NUM_SETS_MASK 0xFFFFFF
+
+// ID_AA64MMFR2_EL1.CCIDX field
+#define MMFR2_CCIDX_OFF 20
+#define MMFR2_CCIDX_MASK 0xF
+
+// CTR_EL0.DminLine field (log2 of the number of words)
+#define CTR_DMIN_LINE_OFF 16
+#define CTR_DMIN_LINE_MASK 0xF
+
+struct cache_topology cache_topology;
+
+// Values used by prefetch.S, defaults are 64 B lines and a 16-way L2
+uint64_t cache_line_shift = 6;
+uint64_t cache_l2_way_shift = 28;
+uint64_t cache_l2_set_shift = 6;
+
+// L2 partition of this core and size from which it is cleaned by set/way
+uint8_t cache_partition_set = 0;
+uint64_t cache_partition_first_set;
+uint64_t cache_partition_last_set;
+uint64_t cache_clean_crossover = UINT64_MAX;
+
+/* Returns log2 of value rounded up */
+uint64_t log2_ceil(uint64_t value)
+{
+    return value <= 1 ? 0 : 64 - __builtin_clzll(value - 1);
+}
+
+void cache_init_topology(void)
+{
+    uint64_t clidr;
+    uint64_t ctr;
+    uint64_t mmfr2;
+
+    asm volatile("mrs %0, clidr_el1" : "=r"(clidr));
+    asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    asm volatile("mrs %0, id_aa64mmfr2_el1" : "=r"(mmfr2));
+    uint8_t ccidx = ((mmfr2 >> MMFR2_CCIDX_OFF) & MMFR2_CCIDX_MASK) != 0;
+
+    // Smallest data line of all levels (words of 4 bytes)
+    cache_topology.data_line_size = 4 << ((ctr >> CTR_DMIN_LINE_OFF) & CTR_DMIN_LINE_MASK);
+
+    cache_topology.level_number = 0;
+    for (uint64_t level = 0; level < CACHE_MAX_LEVELS; level++)
+    {
+        uint64_t type = (clidr >> (level * CLIDR_CTYPE_WIDTH)) & CLIDR_CTYPE_MASK;
+        struct cache_level *cache_level = &cache_topology.levels[level];
+
+        // Stop at the first level without cache
+        if (type == CACHE_TYPE_NONE)
+        {
+            break;
+        }
+        cache_topology.level_number = level + 1;
+        cache_level->type = type;
+
+        // Instruction only cache, no data geometry
+        if (type == CACHE_TYPE_INSTRUCTION)
+        {
+            cache_level->line_size = 0;
+            cache_level->line_shift = 0;
+            cache_level->sets = 0;
+            cache_level->ways = 0;
+            cache_level->size = 0;
+            continue;
+        }
+
+        // Select the data or unified cache of the level and read its geometry
+        uint64_t ccsidr;
+        asm volatile("msr csselr_el1, %0" ::"r"(level << 1));
+        asm volatile("isb");
+        asm volatile("mrs %0, ccsidr_el1" : "=r"(ccsidr));
+
+        cache_level->line_shift = (ccsidr & CCSIDR_LINE_SIZE_MASK) + 4;
+        cache_level->line_size = 1 << cache_level->line_shift;
+        if (ccidx)
+        {
+            cache_level->ways = ((ccsidr >> CCSIDR_ASSOCIATIVITY_OFF) & CCSIDR_CCIDX_ASSOCIATIVITY_MASK) + 1;
+            cache_level->sets = ((ccsidr >> CCSIDR_CCIDX_NUM_SETS_OFF) & CCSIDR_CCIDX_NUM_SETS_MASK) + 1;
+        }
+        else
+        {
+            cache_level->ways = ((ccsidr >> CCSIDR_ASSOCIATIVITY_OFF) & CCSIDR_ASSOCIATIVITY_MASK) + 1;
+            cache_level->sets = ((ccsidr >> CCSIDR_NUM_SETS_OFF) & CCSIDR_NUM_SETS_MASK) + 1;
+        }
+        cache_level->size = cache_level->line_size * cache_level->sets * cache_level->ways;
+    }
+
+    // Update values used by prefetch and maintenance
+    cache_line_shift = log2_ceil(cache_topology.data_line_size);
+    const struct cache_level *l2 = cache_get_level(2);
+    if (l2 != NULL)
+    {
+        cache_l2_way_shift = 32 - log2_ceil(l2->ways);
+        cache_l2_set_shift = l2->line_shift;
+    }
+}
+
+const struct cache_topology *cache_get_topology(void)
+{
+    return &cache_topology;
+}
+
+const struct cache_level *cache_get_level(uint64_t level)
+{
+    if (level == 0 || level > cache_topology.level_number)
+    {
+        return NULL;
+    }
+
+    const struct cache_level *cache_level = &cache_topology.levels[level - 1];
+    if (cache_level->type == CACHE_TYPE_INSTRUCTION)
+    {
+        return NULL;
+    }
+
+    return cache_level;
+}
+
+uint64_t cache_get_line_size(void)
+{
+    return 1 << cache_line_shift;
+}
+
+void cache_set_partition(uint64_t first_set, uint64_t last_set)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+
+    // No L2, nothing to clean by set/way
+    if (l2 == NULL)
+    {
+        return;
+    }
+
+    // Default crossover is where both methods do the same number of operations
+    if (!cache_partition_set)
+    {
+        cache_clean_crossover = (last_set - first_set + 1) * l2->ways * l2->line_size;
+    }
+
+    cache_partition_first_set = first_set;
+    cache_partition_last_set = last_set;
+    cache_partition_set = 1;
+}
+
+uint8_t cache_get_partition(uint64_t *first_set, uint64_t *last_set)
+{
+    *first_set = cache_partition_first_set;
+    *last_set = cache_partition_last_set;
+    return cache_partition_set;
+}
+
+void cache_set_clean_crossover(uint64_t size)
+{
+    cache_clean_crossover = size;
+}
+
+void cache_clean_range(uint64_t address, uint64_t size)
+{
+    if (cache_partition_set && size >= cache_clean_crossover)
+    {
+        const struct cache_level *l2 = cache_get_level(2);
+        clear_L2_cache_CISW(0, l2->ways - 1, cache_partition_first_set, cache_partition_last_set);
+        residency_invalidate_all();
+    }
+    else
+    {
+        clear_L2_cache(address, size);
+        residency_invalidate_range(address, size);
+    }
+}
+
+/*
+ * Invalidates [address ; address + size[ by address. The first and last lines are
+ * cleaned and invalidated if the range does not cover them entirely, they can hold
+ * dirty data around the range.
+ */
+void invalidate_range(uint64_t address, uint64_t size)
+{
+    uint64_t line_mask = cache_get_line_size() - 1;
+    uint64_t end = address + size;
+    uint64_t aligned_start = (address + line_mask) & ~line_mask;
+    uint64_t aligned_end = end & ~line_mask;
+
+    // No whole line in the range
+    if (aligned_start >= aligned_end)
+    {
+        clear_L2_cache(address, size);
+        return;
+    }
+
+    if (address != aligned_start)
+    {
+        clear_L2_cache(address, aligned_start - address);
+    }
+    invalidate_L2_cache(aligned_start, aligned_end - aligned_start);
+    if (end != aligned_end)
+    {
+        clear_L2_cache(aligned_end, end - aligned_end);
+    }
+}
+
+void cache_maintain_range(uint64_t address, uint64_t size, uint8_t maintenance)
+{
+    switch (maintenance)
+    {
+    case CACHE_CLEAN_INVALIDATE:
+        cache_clean_range(address, size);
+        break;
+
+    case CACHE_INVALIDATE:
+        invalidate_range(address, size);
+        residency_invalidate_range(address, size);
+        break;
+
+    case CACHE_CLEAN:
+        clean_L2_cache(address, size);
+        break;
+
+    default:
+        break;
+    }
+}
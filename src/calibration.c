@@ -0,0 +1,113 @@
+#include <calibration.h>
+#include <prefetch.h>
+#include <pmu.h>
+#include <residency.h>
+#include <stdio.h>
+
+// PMU counter used by the calibration
+#define CALIBRATION_COUNTER 0
+
+// Calibration never suspends its loads
+volatile uint8_t calibration_suspend = 0;
+
+/* Loads the candidate, flushes [flush_size] bytes at [flush_address] and returns the L2 refills of the computation */
+uint64_t measure_refills(TaskFunction_t pxTaskCode, void *pvParameters, const struct premtask_region *candidate, uint64_t flush_address, uint64_t flush_size)
+{
+    uint64_t min_refills = UINT64_MAX;
+
+    for (int run = 0; run < CALIBRATION_RUNS; run++)
+    {
+        touch_data_prem((uint64_t)candidate->data, candidate->data_size, &calibration_suspend);
+        clear_L2_cache(flush_address, flush_size);
+
+        pmu_reset_counter(CALIBRATION_COUNTER);
+        pxTaskCode(pvParameters);
+        uint64_t refills = pmu_read_counter(CALIBRATION_COUNTER);
+
+        if (refills < min_refills)
+        {
+            min_refills = refills;
+        }
+    }
+
+    return min_refills;
+}
+
+uint64_t xPREMCalibrate(const char *name,
+                        TaskFunction_t pxTaskCode,
+                        void *pvParameters,
+                        const struct premtask_region candidate,
+                        struct premtask_region *regions,
+                        uint64_t max_region_number)
+{
+    uint64_t start = (uint64_t)candidate.data;
+    uint64_t end = start + candidate.data_size;
+    uint64_t region_number = 0;
+    uint64_t total_size = 0;
+
+    if (max_region_number == 0)
+    {
+        return 0;
+    }
+
+    pmu_enable_counter(CALIBRATION_COUNTER, PMU_L2D_CACHE_REFILL);
+
+    // Warm up (code, stack) then measure refills when all data is there
+    measure_refills(pxTaskCode, pvParameters, &candidate, start, 0);
+    uint64_t baseline = measure_refills(pxTaskCode, pvParameters, &candidate, start, 0);
+
+    // Flush each page in turn, if the computation refills more then it uses the page
+    uint64_t page_start = start & ~((uint64_t)CALIBRATION_PAGE_SIZE - 1);
+    for (; page_start < end; page_start += CALIBRATION_PAGE_SIZE)
+    {
+        uint64_t used_start = page_start < start ? start : page_start;
+        uint64_t used_end = page_start + CALIBRATION_PAGE_SIZE > end ? end : page_start + CALIBRATION_PAGE_SIZE;
+
+        if (measure_refills(pxTaskCode, pvParameters, &candidate, used_start, used_end - used_start) <= baseline + CALIBRATION_REFILL_THRESHOLD)
+        {
+            continue;
+        }
+
+        // Merge with the previous region if contiguous
+        if (region_number > 0 && (uint64_t)regions[region_number - 1].data + regions[region_number - 1].data_size == used_start)
+        {
+            regions[region_number - 1].data_size += used_end - used_start;
+        }
+        else if (region_number < max_region_number)
+        {
+            regions[region_number].data = (void *)used_start;
+            regions[region_number].data_size = used_end - used_start;
+            regions[region_number].access = candidate.access;
+            regions[region_number].keep_warm = candidate.keep_warm;
+            region_number++;
+        }
+        else
+        {
+            // Not enough regions, extend the last one (prefetches a bit more than needed)
+            regions[region_number - 1].data_size = used_end - (uint64_t)regions[region_number - 1].data;
+        }
+    }
+
+    // What will really be prefetched (extended regions included)
+    for (uint64_t region = 0; region < region_number; region++)
+    {
+        total_size += regions[region].data_size;
+    }
+
+    pmu_disable_counter(CALIBRATION_COUNTER);
+
+    // The calibration flushed and loaded things everywhere
+    residency_invalidate_all();
+
+    // Print it as region list to paste (offsets from the candidate start)
+    printf("# Calibration of %s: %llu refills when all data is loaded\n", name, baseline);
+    printf("calibrated_size_%s = %llu # B (candidate %llu B)\n", name, total_size, candidate.data_size);
+    printf("# struct premtask_region %s_regions[] = {\n", name);
+    for (uint64_t region = 0; region < region_number; region++)
+    {
+        printf("#     {.data = data + 0x%llx, .data_size = 0x%llx},\n", (uint64_t)regions[region].data - start, regions[region].data_size);
+    }
+    printf("# };\n");
+
+    return region_number;
+}
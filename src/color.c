@@ -0,0 +1,169 @@
+#include <color.h>
+#include <cache.h>
+
+#define COLOR_POOL_PAGES (COLOR_POOL_SIZE / COLOR_PAGE_SIZE)
+
+#if COLOR_POOL_SIZE > 0
+// Pool where colored pages are taken, aligned so that its first page is color 0 on most L2
+uint8_t color_pool[COLOR_POOL_SIZE] __attribute__((section(".bss.color.pool"), aligned(0x10000)));
+uint8_t color_pool_used_pages[COLOR_POOL_PAGES];
+#else
+// No pool (make COLOR_POOL=size), there is no page so allocations fail
+uint8_t *const color_pool = NULL;
+uint8_t *const color_pool_used_pages = NULL;
+#endif
+
+uint64_t color_get_number(void)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+
+    // No L2, then everything has the same color
+    if (l2 == NULL || l2->sets * l2->line_size < COLOR_PAGE_SIZE)
+    {
+        return 1;
+    }
+
+    return (l2->sets * l2->line_size) / COLOR_PAGE_SIZE;
+}
+
+uint64_t color_get_color(const void *address)
+{
+    return ((uint64_t)address / COLOR_PAGE_SIZE) % color_get_number();
+}
+
+uint64_t color_get_mask(const void *address, uint64_t size)
+{
+    uint64_t color_number = color_get_number();
+    uint64_t mask = 0;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    // All colors are used
+    uint64_t first_page = (uint64_t)address / COLOR_PAGE_SIZE;
+    uint64_t last_page = ((uint64_t)address + size - 1) / COLOR_PAGE_SIZE;
+    if (last_page - first_page + 1 >= color_number)
+    {
+        return color_number >= COLOR_MAX_NUMBER ? ~0ULL : COLOR_MASK(0, color_number - 1);
+    }
+
+    for (uint64_t page = first_page; page <= last_page; page++)
+    {
+        mask |= 1ULL << ((page % color_number) % COLOR_MAX_NUMBER);
+    }
+
+    return mask;
+}
+
+void color_set_cache_partition(uint64_t first_color, uint64_t last_color)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+    if (l2 == NULL)
+    {
+        return;
+    }
+
+    uint64_t color_sets = l2->sets / color_get_number();
+    cache_set_partition(first_color * color_sets, (last_color + 1) * color_sets - 1);
+}
+
+/* Returns 1 if the page of the pool is free and has a color of the mask */
+uint8_t is_page_usable(uint64_t page, uint64_t color_mask)
+{
+    return !color_pool_used_pages[page] && (color_mask & (1ULL << (color_get_color(&color_pool[page * COLOR_PAGE_SIZE]) % COLOR_MAX_NUMBER)));
+}
+
+void *color_malloc(uint64_t size, uint64_t color_mask)
+{
+    uint64_t page_number = (size + COLOR_PAGE_SIZE - 1) / COLOR_PAGE_SIZE;
+    uint64_t run_length = 0;
+
+    if (page_number == 0)
+    {
+        return NULL;
+    }
+
+    // First fit: look for enough consecutive usable pages
+    for (uint64_t page = 0; page < COLOR_POOL_PAGES; page++)
+    {
+        run_length = is_page_usable(page, color_mask) ? run_length + 1 : 0;
+        if (run_length == page_number)
+        {
+            uint64_t first_page = page + 1 - page_number;
+            for (uint64_t used_page = first_page; used_page <= page; used_page++)
+            {
+                color_pool_used_pages[used_page] = 1;
+            }
+            return &color_pool[first_page * COLOR_PAGE_SIZE];
+        }
+    }
+
+    return NULL;
+}
+
+uint64_t color_malloc_regions(uint64_t size, uint64_t color_mask, struct premtask_region *regions, uint64_t max_region_number)
+{
+    uint64_t page_number = (size + COLOR_PAGE_SIZE - 1) / COLOR_PAGE_SIZE;
+    uint64_t region_number = 0;
+    uint64_t last_page = COLOR_POOL_PAGES;
+
+    if (page_number == 0 || max_region_number == 0)
+    {
+        return 0;
+    }
+
+    // Take usable pages in order, merging consecutive ones in the same region
+    for (uint64_t page = 0; page < COLOR_POOL_PAGES && page_number > 0; page++)
+    {
+        if (!is_page_usable(page, color_mask))
+        {
+            continue;
+        }
+
+        if (region_number > 0 && last_page + 1 == page)
+        {
+            regions[region_number - 1].data_size += COLOR_PAGE_SIZE;
+        }
+        else if (region_number < max_region_number)
+        {
+            regions[region_number].data = &color_pool[page * COLOR_PAGE_SIZE];
+            regions[region_number].data_size = COLOR_PAGE_SIZE;
+            regions[region_number].access = PREM_ACCESS_READ_WRITE;
+            regions[region_number].keep_warm = 0;
+            region_number++;
+        }
+        else
+        {
+            break;
+        }
+
+        color_pool_used_pages[page] = 1;
+        last_page = page;
+        page_number--;
+    }
+
+    // Not enough pages or regions, give back what was taken
+    if (page_number > 0)
+    {
+        for (uint64_t region = 0; region < region_number; region++)
+        {
+            color_free(regions[region].data, regions[region].data_size);
+        }
+        return 0;
+    }
+
+    return region_number;
+}
+
+void color_free(void *address, uint64_t size)
+{
+    uint64_t first_page = ((uint8_t *)address - color_pool) / COLOR_PAGE_SIZE;
+    uint64_t page_number = (size + COLOR_PAGE_SIZE - 1) / COLOR_PAGE_SIZE;
+
+    for (uint64_t page = first_page; page < first_page + page_number && page < COLOR_POOL_PAGES; page++)
+    {
+        color_pool_used_pages[page] = 0;
+    }
+}
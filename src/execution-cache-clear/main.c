@@ -16,6 +16,8 @@
 #include <data.h>
 #include <generic_timer.h>
 #include <benchmark.h>
+#include <cache.h>
+#include <color.h>
 
 // Request the default IPI and memory request wait
 #ifdef DEFAULT_IPI_HANDLERS
@@ -38,10 +40,28 @@ int print_counter = 0;
 uint64_t data_size = 0;
 volatile uint8_t suspend_prefetch = 0;
 
+// L2 geometry of the board and partition of this core (the same as PREM, cf. vInitPREM)
+const struct cache_level *l2_cache;
+uint64_t partition_first_set;
+uint64_t partition_last_set;
+
+// Cost of cleaning only the data by address or the whole partition by set/way
+struct benchmark_ctx va_benchmark;
+struct benchmark_ctx setway_benchmark;
+
 void clear_cache(void* arg)
 {
-    // clear_L2_cache_CISW((uint64_t)0, (uint64_t)15, (uint64_t)0, (uint64_t)(((0x100000 / 16) / 4) - 1));
-    clear_L2_cache((uint64_t)appdata, 1024 kB);
+    clear_L2_cache((uint64_t)appdata, l2_cache->size);
+}
+
+void clear_cache_va(void* arg)
+{
+    clear_L2_cache((uint64_t)appdata, data_size);
+}
+
+void clear_cache_setway(void* arg)
+{
+    clear_L2_cache_CISW((uint64_t)0, l2_cache->ways - 1, partition_first_set, partition_last_set);
 }
 
 void vMasterTask(void *pvParameters)
@@ -49,6 +69,7 @@ void vMasterTask(void *pvParameters)
     start_benchmark();
     printf("\t# Number of realised tests: %d\n", counter);
     clear_L2_cache((uint64_t)appdata, (uint64_t)DATA_SIZE);
+    uint64_t crossover = 0;
 
     for (data_size = MIN_DATA_SIZE; data_size <= DATA_SIZE; data_size += DATA_SIZE_INCREMENT)
     {
@@ -58,12 +79,25 @@ void vMasterTask(void *pvParameters)
         sprintf(test_name, "_%dkB", data_size_ko);
         init_benchmark(test_name, MEASURE_NANO, 1);
 
+        char va_name[24];
+        char setway_name[24];
+        sprintf(va_name, "_va_%dkB", data_size_ko);
+        sprintf(setway_name, "_setway_%dkB", data_size_ko);
+        benchmark_ctx_init(&va_benchmark, va_name, MEASURE_NANO, 0);
+        benchmark_ctx_init(&setway_benchmark, setway_name, MEASURE_NANO, 0);
+
         while (counter++ < NUMBER_OF_TESTS)
         {
             // Prefetch data and measure cache clear
             prefetch_data_prem((uint64_t)appdata, (uint64_t)data_size, &suspend_prefetch);
             run_benchmark(clear_cache, NULL);
 
+            // Same for the data only, by address and by set/way
+            prefetch_data_prem((uint64_t)appdata, (uint64_t)data_size, &suspend_prefetch);
+            benchmark_ctx_run(&va_benchmark, clear_cache_va, NULL);
+            prefetch_data_prem((uint64_t)appdata, (uint64_t)data_size, &suspend_prefetch);
+            benchmark_ctx_run(&setway_benchmark, clear_cache_setway, NULL);
+
             // Print for each 1000 tests
             if (++print_counter == 1000)
             {
@@ -76,9 +110,20 @@ void vMasterTask(void *pvParameters)
         counter = 0;
         print_counter = 0;
         print_benchmark_results();
+        benchmark_ctx_report(&va_benchmark);
+        benchmark_ctx_report(&setway_benchmark);
         printf("\n");
+
+        // First size from which set/way is faster (cf. cache_set_clean_crossover)
+        if (crossover == 0 && benchmark_ctx_get_average_time(&setway_benchmark) <= benchmark_ctx_get_average_time(&va_benchmark))
+        {
+            crossover = data_size;
+        }
     }
 
+    // 0 if set/way was never faster
+    printf("clean_crossover = %llu # B\n", crossover);
+
     end_benchmark();
     vTaskDelete(NULL);
 }
@@ -88,6 +133,17 @@ void main_app(void)
 {
     timer_frequency = generic_timer_get_freq();
     uint64_t cpu_id = hypercall(HC_GET_CPU_ID, 0, 0, 0);
+    l2_cache = cache_get_level(2);
+    configASSERT(l2_cache != NULL);
+
+    // Measure on the sets that PREM cleans by set/way (make CACHE_COLORS=first-last), a quarter of the colors if not given
+#ifdef PREM_CACHE_FIRST_COLOR
+    color_set_cache_partition(PREM_CACHE_FIRST_COLOR, PREM_CACHE_LAST_COLOR);
+#else
+    color_set_cache_partition(0, (color_get_number() + 3) / 4 - 1);
+#endif
+    cache_get_partition(&partition_first_set, &partition_last_set);
+    printf("# Set/way partition: sets %llu to %llu\n", partition_first_set, partition_last_set);
 
     printf("Begin cache clear tests...\n");
     xTaskCreate(
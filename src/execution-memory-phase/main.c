@@ -0,0 +1,151 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <uart.h>
+#include <irq.h>
+#include <plat.h>
+
+#include <stdio.h>
+
+#include <hypervisor.h>
+#include <prefetch.h>
+#include <prem_task.h>
+#include <data.h>
+#include <generic_timer.h>
+#include <benchmark.h>
+#include <histogram.h>
+#include <pmu.h>
+#include <cache.h>
+
+// Request the default IPI and memory request wait
+#ifdef DEFAULT_IPI_HANDLERS
+#error DEFAULT_IPI must not be defined with value y for this test (make all ... DEFAULT_IPI=y is no!)
+#endif
+
+// Task handler
+TaskHandle_t xTaskHandler;
+
+#define NUMBER_OF_TESTS 10000
+#define DATA_SIZE MAX_DATA_SIZE
+#define MIN_DATA_SIZE 16 kB
+#define DATA_SIZE_INCREMENT 16 kB
+
+// PMU counter used to count L2 refills of the computation phase
+#define REFILL_COUNTER 0
+
+int counter = 0;
+int print_counter = 0;
+uint64_t data_size = 0;
+volatile uint8_t suspend_prefetch = 0;
+
+// Memory phase length and computation phase L2 refills for each strategy
+struct benchmark_ctx prefetch_benchmark;
+struct benchmark_ctx touch_benchmark;
+struct histogram prefetch_refills;
+struct histogram touch_refills;
+
+void memory_phase_prefetch(void *arg)
+{
+    union memory_request_answer answer = {.raw = request_memory_access(0, 0)};
+    suspend_prefetch = !answer.ack;
+    prefetch_data_prem((uint64_t)appdata, data_size, &suspend_prefetch);
+    revoke_memory_access();
+}
+
+void memory_phase_touch(void *arg)
+{
+    union memory_request_answer answer = {.raw = request_memory_access(0, 0)};
+    suspend_prefetch = !answer.ack;
+    touch_data_prem((uint64_t)appdata, data_size, &suspend_prefetch);
+    revoke_memory_access();
+}
+
+/* Reads all lines of the data like a computation phase and returns the number of L2 refills */
+uint64_t computation_phase(void)
+{
+    volatile uint8_t *data = appdata;
+    uint64_t line_size = cache_get_line_size();
+    uint64_t sum = 0;
+
+    pmu_reset_counter(REFILL_COUNTER);
+    for (uint64_t index = 0; index < data_size; index += line_size)
+    {
+        sum += data[index];
+    }
+
+    // Only there so the compiler keeps the sum
+    (void)sum;
+    return pmu_read_counter(REFILL_COUNTER);
+}
+
+void vMasterTask(void *pvParameters)
+{
+    start_benchmark();
+    pmu_enable_counter(REFILL_COUNTER, PMU_L2D_CACHE_REFILL);
+
+    for (data_size = MIN_DATA_SIZE; data_size <= DATA_SIZE; data_size += DATA_SIZE_INCREMENT)
+    {
+        // Init benchmarks
+        int data_size_ko = BtkB(data_size);
+        char prefetch_name[24];
+        char touch_name[24];
+        sprintf(prefetch_name, "_prefetch_%dkB", data_size_ko);
+        sprintf(touch_name, "_touch_%dkB", data_size_ko);
+        benchmark_ctx_init(&prefetch_benchmark, prefetch_name, MEASURE_NANO, 0);
+        benchmark_ctx_init(&touch_benchmark, touch_name, MEASURE_NANO, 0);
+        histogram_reset(&prefetch_refills);
+        histogram_reset(&touch_refills);
+
+        while (counter++ < NUMBER_OF_TESTS)
+        {
+            // Prefetch strategy
+            clear_L2_cache((uint64_t)appdata, data_size);
+            benchmark_ctx_run(&prefetch_benchmark, memory_phase_prefetch, NULL);
+            histogram_record(&prefetch_refills, computation_phase());
+
+            // Touch strategy
+            clear_L2_cache((uint64_t)appdata, data_size);
+            benchmark_ctx_run(&touch_benchmark, memory_phase_touch, NULL);
+            histogram_record(&touch_refills, computation_phase());
+
+            // Print for each 1000 tests
+            if (++print_counter == 1000)
+            {
+                printf("\t# Number of realised tests: %d\n", counter);
+                print_counter = 0;
+            }
+        }
+
+        // Reset counters
+        counter = 0;
+        print_counter = 0;
+
+        // Memory phase length and L2 refills of the computation phase
+        char refill_name[32];
+        benchmark_ctx_report(&prefetch_benchmark);
+        sprintf(refill_name, "_refills%s", prefetch_name);
+        histogram_print_percentiles(&prefetch_refills, refill_name, "L2 refills");
+        benchmark_ctx_report(&touch_benchmark);
+        sprintf(refill_name, "_refills%s", touch_name);
+        histogram_print_percentiles(&touch_refills, refill_name, "L2 refills");
+        printf("\n");
+    }
+
+    pmu_disable_counter(REFILL_COUNTER);
+    end_benchmark();
+    vTaskDelete(NULL);
+}
+
+void main_app(void)
+{
+    printf("Begin memory phase strategy tests...\n");
+    xTaskCreate(
+        vMasterTask,
+        "MasterTask",
+        configMINIMAL_STACK_SIZE,
+        NULL,
+        tskIDLE_PRIORITY + 1,
+        &(xTaskHandler));
+
+    vTaskStartScheduler();
+}
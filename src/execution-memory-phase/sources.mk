@@ -0,0 +1 @@
+spec_c_srcs:= main.c
\ No newline at end of file
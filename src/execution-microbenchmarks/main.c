@@ -26,6 +26,12 @@ volatile uint8_t ipi_received;
 uint64_t end_ipi_time;
 volatile uint64_t answer;
 
+// One benchmark context per measured path
+struct benchmark_ctx hypercall_benchmark;
+struct benchmark_ctx ipi_benchmark;
+struct benchmark_ctx arbitration_request_benchmark;
+struct benchmark_ctx arbitration_revoke_benchmark;
+
 void wait_for(uint64_t waitingTicks)
 {
     uint64_t current_time = generic_timer_read_counter();
@@ -65,11 +71,11 @@ void vHypercallTask(void *pvParameters)
     int counter = 0;
     int print_counter = 0;
 
-    init_benchmark("_hypercall", MEASURE_NANO, 1);
+    benchmark_ctx_init(&hypercall_benchmark, "_hypercall", MEASURE_NANO, 1);
     while (counter < NUMBER_OF_TESTS)
     {
         // Benchmark prefetching
-        run_benchmark(bench_hypercall, NULL);
+        benchmark_ctx_run(&hypercall_benchmark, bench_hypercall, NULL);
 
         // Increment counter
         counter += 1;
@@ -86,7 +92,7 @@ void vHypercallTask(void *pvParameters)
     }
 
     // Show results and destroy task
-    print_benchmark_results();
+    benchmark_ctx_report(&hypercall_benchmark);
     printf("\n");
     vTaskDelete(NULL);
 }
@@ -95,16 +101,11 @@ void vIPITask(void *pvParameters)
 {
     uint64_t base_frequency = generic_timer_get_freq();
 
-    // Redo benchmarking here since we don't measure time of an OS function
+    // Time is not measured around a function, so record it in the context
     int counter = 0;
     int print_counter = 0;
 
-    uint64_t max_time = 0;
-    uint64_t min_time = -1;
-    uint64_t sum = 0;
-
-    // Init benchmark string
-    printf("elapsed_time_array_ipi_ns = [");
+    benchmark_ctx_init(&ipi_benchmark, "_ipi", MEASURE_NANO, 1);
 
     while (counter < NUMBER_OF_TESTS)
     {
@@ -123,23 +124,8 @@ void vIPITask(void *pvParameters)
         // Compute the time taken by the IPI
         uint64_t ipi_time = end_ipi_time - start_ipi_time;
 
-        /* Benchmark stuff */
-        // Increase sum
-        sum += ipi_time;
-
-        // Test min and max
-        if (ipi_time > max_time)
-        {
-            max_time = ipi_time;
-        }
-
-        if (ipi_time < min_time)
-        {
-            min_time = ipi_time;
-        }
-
-        // Print the result
-        printf("%ld,", pdSYSTICK_TO_NS(base_frequency, ipi_time));
+        // Record the result
+        benchmark_ctx_record(&ipi_benchmark, ipi_time);
         if (++print_counter == 1000)
         {
             printf("\t# Number of realised tests: %d\n", counter);
@@ -150,14 +136,8 @@ void vIPITask(void *pvParameters)
         wait_for(pdUS_TO_SYSTICK(base_frequency, 100));
     }
 
-    // Compute average
-    uint64_t average_time = sum / NUMBER_OF_TESTS;
-
     // Print results
-    printf("]\n"); // End of array
-    printf("min_ipi_ns = %ld # ns\n", pdSYSTICK_TO_NS(base_frequency, min_time));
-    printf("max_ipi_ns = %ld # ns\n", pdSYSTICK_TO_NS(base_frequency, max_time));
-    printf("int_average_ipi_ns = %ld # ns\n", pdSYSTICK_TO_NS(base_frequency, average_time));
+    benchmark_ctx_report(&ipi_benchmark);
     printf("\n");
 
     vTaskDelete(NULL);
@@ -167,18 +147,16 @@ void vArbitrationRequestTask(void *pvParameters)
 {
     uint64_t base_frequency = generic_timer_get_freq();
 
-    // Redo benchmarking here since we don't measure time of an OS function
+    // Time is measured by the hypervisor, so record it in the context
     for (int prio = 0; prio <= 6; prio += 2)
     {
         int counter = 0;
         int print_counter = 0;
 
-        uint64_t max_time = 0;
-        uint64_t min_time = -1;
-        uint64_t sum = 0;
-
-        // Init benchmark string
-        printf("elapsed_time_array_request_prio%d_ns = [", prio);
+        // Init benchmark
+        char benchmark_name[20];
+        sprintf(benchmark_name, "_request_prio%d", prio);
+        benchmark_ctx_init(&arbitration_request_benchmark, benchmark_name, MEASURE_NANO, 1);
 
         while (counter < NUMBER_OF_TESTS)
         {
@@ -190,23 +168,8 @@ void vArbitrationRequestTask(void *pvParameters)
             // Revoke memory access
             revoke_memory_access();
 
-            /* Benchmark stuff */
-            // Increase sum
-            sum += arbitration_time;
-
-            // Test min and max
-            if (arbitration_time > max_time)
-            {
-                max_time = arbitration_time;
-            }
-
-            if (arbitration_time < min_time)
-            {
-                min_time = arbitration_time;
-            }
-
-            // Print the result
-            printf("%ld,", pdSYSTICK_TO_NS(base_frequency, arbitration_time));
+            // Record the result
+            benchmark_ctx_record(&arbitration_request_benchmark, arbitration_time);
             if (++print_counter == 1000)
             {
                 printf("\t# Number of realised tests: %d\n", counter);
@@ -217,14 +180,8 @@ void vArbitrationRequestTask(void *pvParameters)
             wait_for(pdUS_TO_SYSTICK(base_frequency, 100));
         }
 
-        // Compute average
-        uint64_t average_time = sum / NUMBER_OF_TESTS;
-
         // Print results
-        printf("]\n"); // End of array
-        printf("min_request_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, min_time));
-        printf("max_request_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, max_time));
-        printf("int_average_request_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, average_time));
+        benchmark_ctx_report(&arbitration_request_benchmark);
         printf("\n");
     }
 
@@ -235,18 +192,16 @@ void vArbitrationRevokeTask(void *pvParameters)
 {
     uint64_t base_frequency = generic_timer_get_freq();
 
-    // Redo benchmarking here since we don't measure time of an OS function
+    // Time is measured by the hypervisor, so record it in the context
     for (int prio = 0; prio <= 6; prio += 2)
     {
         int counter = 0;
         int print_counter = 0;
 
-        uint64_t max_time = 0;
-        uint64_t min_time = -1;
-        uint64_t sum = 0;
-
-        // Init benchmark string
-        printf("elapsed_time_array_revoke_prio%d_ns = [", prio);
+        // Init benchmark
+        char benchmark_name[20];
+        sprintf(benchmark_name, "_revoke_prio%d", prio);
+        benchmark_ctx_init(&arbitration_revoke_benchmark, benchmark_name, MEASURE_NANO, 1);
 
         while (counter < NUMBER_OF_TESTS)
         {
@@ -261,23 +216,8 @@ void vArbitrationRevokeTask(void *pvParameters)
             // Revoke and measure it
             uint64_t arbitration_time = hypercall(HC_REVOKE_MEM_ACCESS_TIMER, prio, 0, 0);
 
-            /* Benchmark stuff */
-            // Increase sum
-            sum += arbitration_time;
-
-            // Test min and max
-            if (arbitration_time > max_time)
-            {
-                max_time = arbitration_time;
-            }
-
-            if (arbitration_time < min_time)
-            {
-                min_time = arbitration_time;
-            }
-
-            // Print the result
-            printf("%ld,", pdSYSTICK_TO_NS(base_frequency, arbitration_time));
+            // Record the result
+            benchmark_ctx_record(&arbitration_revoke_benchmark, arbitration_time);
             if (++print_counter == 1000)
             {
                 printf("\t# Number of realised tests: %d\n", counter);
@@ -285,14 +225,8 @@ void vArbitrationRevokeTask(void *pvParameters)
             }
         }
 
-        // Compute average
-        uint64_t average_time = sum / NUMBER_OF_TESTS;
-
         // Print results
-        printf("]\n"); // End of array
-        printf("min_revoke_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, min_time));
-        printf("max_revoke_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, max_time));
-        printf("int_average_revoke_prio%d_ns = %ld # ns\n", prio, pdSYSTICK_TO_NS(base_frequency, average_time));
+        benchmark_ctx_report(&arbitration_revoke_benchmark);
         printf("\n");
     }
 
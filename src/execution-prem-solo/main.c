@@ -9,6 +9,7 @@
 
 #include <hypervisor.h>
 #include <prefetch.h>
+#include <prefetch_inc.h>
 #include <state_machine.h>
 #include <ipi.h>
 #include <periodic_task.h>
@@ -56,6 +57,9 @@ void prefetch(void *arg)
 void vMasterTask(void *pvParameters)
 {
     start_benchmark();
+
+    // Pause latency depends on the suspend check granularity, compare runs with PREFETCH_CHECK_LINES=...
+    printf("prefetch_check_lines = %d\n", PREFETCH_CHECK_LINES);
     printf("\t# Number of realised tests: %d\n", counter);
 
     for (data_size = MIN_DATA_SIZE; data_size <= DATA_SIZE; data_size += DATA_SIZE_INCREMENT)
@@ -4,6 +4,9 @@
 // MPEG2
 // Functions
 unsigned char *get_mpeg2_oldorgframe(void);
+unsigned long get_mpeg2_oldorgframe_size(void);
+unsigned char *get_mpeg2_mbinfo(void);
+unsigned long get_mpeg2_mbinfo_size(void);
 void mpeg2_main(void *);
 
 // Countnegative
@@ -16,6 +16,7 @@
 #include <data.h>
 #include <generic_timer.h>
 #include <benchmark.h>
+#include <calibration.h>
 #include "inc/TACle.h"
 
 // To use with 1 processor for WCET measure, 4 processors for taskset measurement
@@ -23,12 +24,28 @@
 // First one does not count
 #define NUMBER_OF_TESTS 30001
 
+// Weight average works on two halves of appdata
+#define WEIGHTAVG_HALF_SIZE 230 kB
+#define WEIGHTAVG_OFFSET_1 0
+#define WEIGHTAVG_OFFSET_2 WEIGHTAVG_HALF_SIZE
+
 struct task_parameters
 {
     benchmark_t task_function;
     uint64_t counter;
 };
 
+#ifdef PREM_CALIBRATION
+// Maximum number of calibrated regions per task
+#define CALIBRATED_REGIONS 16
+
+// Calibrated regions of each task
+struct premtask_region mpeg_calibrated[CALIBRATED_REGIONS];
+struct premtask_region countnegative_calibrated[CALIBRATED_REGIONS];
+struct premtask_region bubblesort_calibrated[CALIBRATED_REGIONS];
+struct premtask_region weightavg_calibrated[CALIBRATED_REGIONS];
+#endif
+
 extern uint64_t cpu_priority;
 uint64_t ntest_mpeg = 0;
 uint64_t ntest_countnegative = 0;
@@ -40,8 +57,8 @@ void weightavg_task(void *pvParameters)
 {
     // Will perform sum += (array1[i] - array[2]) / 2
     // 460kB of appdata loaded in the cache!
-    uint32_t offset_1 = 0;
-    uint32_t offset_2 = 230 * 1024;
+    uint32_t offset_1 = WEIGHTAVG_OFFSET_1;
+    uint32_t offset_2 = WEIGHTAVG_OFFSET_2;
 
     volatile uint64_t array_sum = 0;
     volatile uint64_t array_avg = 0;
@@ -53,6 +70,30 @@ void weightavg_task(void *pvParameters)
     array_avg = array_sum / offset_2;
 }
 
+#ifdef PREM_CALIBRATION
+/* Replaces the regions of the task by the pages its computation really uses */
+void calibrate_task(const char *name, benchmark_t task_function, struct premtask_parameters *premtask_parameters, struct premtask_region *calibrated)
+{
+    // Single region tasks use data and data_size
+    struct premtask_region single_region = {.data = premtask_parameters->data, .data_size = premtask_parameters->data_size, .access = premtask_parameters->data_access, .keep_warm = premtask_parameters->data_keep_warm};
+    const struct premtask_region *candidates = premtask_parameters->region_number == 0 ? &single_region : premtask_parameters->regions;
+    uint64_t candidate_number = premtask_parameters->region_number == 0 ? 1 : premtask_parameters->region_number;
+
+    uint64_t region_number = 0;
+    for (uint64_t candidate = 0; candidate < candidate_number; candidate++)
+    {
+        region_number += xPREMCalibrate(name, task_function, NULL, candidates[candidate], calibrated + region_number, CALIBRATED_REGIONS - region_number);
+    }
+
+    // Nothing found (no PMU?), keep the candidates
+    if (region_number > 0)
+    {
+        premtask_parameters->region_number = region_number;
+        premtask_parameters->regions = calibrated;
+    }
+}
+#endif
+
 void master_task(void *pvParameters)
 {
     struct task_parameters *task_parameters = (struct task_parameters *)pvParameters;
@@ -67,6 +108,14 @@ void master_task(void *pvParameters)
 
 struct task_parameters mpeg, countnegative, bubblesort, weightavg;
 
+// Tasks are statically allocated, so the taskset is created without any heap allocation
+#define TACLE_STACK_DEPTH (1 MB >> sizeof(StackType_t))
+StackType_t mpeg_stack[TACLE_STACK_DEPTH];
+StackType_t weightavg_stack[TACLE_STACK_DEPTH];
+StackType_t countnegative_stack[TACLE_STACK_DEPTH];
+StackType_t bubblesort_stack[TACLE_STACK_DEPTH];
+struct premtask_buffer mpeg_buffer, weightavg_buffer, countnegative_buffer, bubblesort_buffer;
+
 void main_app(void)
 {
     // start_benchmark();
@@ -89,11 +138,13 @@ void main_app(void)
     // Create for all processors the same tasks, all will measure
     mpeg.task_function = mpeg2_main;
     mpeg.counter = ntest_mpeg;
-    struct premtask_parameters mpeg_struct = {.tickPeriod = pdMS_TO_TICKS(45), .data_size = 88 kB * 4, .data = mpeg_data, .wcet = 4755907, .pvParameters = &mpeg};
+    struct premtask_region mpeg_regions[] = {{.data = mpeg_data, .data_size = get_mpeg2_oldorgframe_size()},
+                                             {.data = get_mpeg2_mbinfo(), .data_size = get_mpeg2_mbinfo_size()}};
+    struct premtask_parameters mpeg_struct = {.tickPeriod = pdMS_TO_TICKS(45), .wcet = 4755907, .pvParameters = &mpeg, .region_number = 2, .regions = mpeg_regions};
 
     countnegative.task_function = countnegative_main;
     countnegative.counter = ntest_countnegative;
-    struct premtask_parameters countnegative_struct = {.tickPeriod = pdMS_TO_TICKS(55), .data_size = CN_MAXSIZE * CN_MAXSIZE, .data = countnegative_data, .wcet = 6083944, .pvParameters = &countnegative};
+    struct premtask_parameters countnegative_struct = {.tickPeriod = pdMS_TO_TICKS(55), .data_size = CN_MAXSIZE * CN_MAXSIZE, .data = countnegative_data, .data_access = PREM_ACCESS_READ_ONLY, .wcet = 6083944, .pvParameters = &countnegative};
 
     bubblesort.task_function = bubblesort_main;
     bubblesort.counter = ntest_bubblesort;
@@ -101,39 +152,52 @@ void main_app(void)
 
     weightavg.task_function = weightavg_task;
     weightavg.counter = ntest_weightavg;
-    struct premtask_parameters weightavg_struct = {.tickPeriod = pdMS_TO_TICKS(50), .data_size = 460 kB, .data = appdata, .wcet = 5861944, .pvParameters = &weightavg};
-
-    xTaskPREMCreate(
+    // The two halves are contiguous, so they are one region
+    struct premtask_parameters weightavg_struct = {.tickPeriod = pdMS_TO_TICKS(50), .data_size = 2 * WEIGHTAVG_HALF_SIZE, .data = appdata, .data_access = PREM_ACCESS_READ_ONLY, .wcet = 5861944, .pvParameters = &weightavg};
+
+#ifdef PREM_CALIBRATION
+    // Prefetch only what the computation phases use
+    calibrate_task("mpeg2", mpeg2_main, &mpeg_struct, mpeg_calibrated);
+    calibrate_task("weightavg", weightavg_task, &weightavg_struct, weightavg_calibrated);
+    calibrate_task("countnegative", countnegative_main, &countnegative_struct, countnegative_calibrated);
+    calibrate_task("bubblesort", bubblesort_main, &bubblesort_struct, bubblesort_calibrated);
+#endif
+
+    xTaskPREMCreateStatic(
         master_task,
         "MPEG2",
-        1 MB >> sizeof(StackType_t),
+        TACLE_STACK_DEPTH,
         mpeg_struct,
         4,
-        NULL);
+        mpeg_stack,
+        &mpeg_buffer);
 
-    xTaskPREMCreate(
+    xTaskPREMCreateStatic(
         master_task,
         "Weight average",
-        1 MB >> sizeof(StackType_t),
+        TACLE_STACK_DEPTH,
         weightavg_struct,
         3,
-        NULL);
+        weightavg_stack,
+        &weightavg_buffer);
 
-    xTaskPREMCreate(
+    xTaskPREMCreateStatic(
         master_task,
         "Count negative",
-        1 MB >> sizeof(StackType_t),
+        TACLE_STACK_DEPTH,
         countnegative_struct,
         2,
-        NULL);
+        countnegative_stack,
+        &countnegative_buffer);
 
-    xTaskPREMCreate(
+    xTaskPREMCreateStatic(
         master_task,
         "Bubble sort",
-        1 MB >> sizeof(StackType_t),
+        TACLE_STACK_DEPTH,
         bubblesort_struct,
         1,
-        NULL);
+        bubblesort_stack,
+        &bubblesort_buffer);
 
 
     vInitPREM();
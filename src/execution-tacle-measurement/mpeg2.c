@@ -13139,6 +13139,21 @@ unsigned char *get_mpeg2_oldorgframe()
   return (unsigned char *)mpeg2_oldorgframe;
 }
 
+unsigned long get_mpeg2_oldorgframe_size()
+{
+  return sizeof( mpeg2_oldorgframe );
+}
+
+unsigned char *get_mpeg2_mbinfo()
+{
+  return (unsigned char *)mpeg2_mbinfo;
+}
+
+unsigned long get_mpeg2_mbinfo_size()
+{
+  return sizeof( mpeg2_mbinfo );
+}
+
 /*
   Main functions
 */
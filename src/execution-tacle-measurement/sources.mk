@@ -3,6 +3,11 @@ CPPFLAGS+=-DMEASURE_RESPONSE_TIME
 CPPFLAGS+=-DDEFAULT_IPI_HANDLERS
 CPPFLAGS+=-DMEMORY_REQUEST_WAIT
 
+# Calibrate the regions of the PREM tasks before starting them
+ifeq ($(CALIBRATION),y)
+CPPFLAGS+=-DPREM_CALIBRATION
+endif
+
 ifeq ($(LEGACY),y)
 spec_c_srcs:= main_legacy.c
 else
@@ -1,13 +1,69 @@
 #include <FreeRTOS.h>
 #include <generic_timer.h>
+#include <irq.h>
 
 uint64_t cntfrq = 0;
 
+// Deadlines of the physical timer channels (0 if not armed) and their handlers
+uint64_t deadlines[GENERIC_TIMER_DEADLINE_NUMBER] = {0};
+deadline_handler_t deadline_handlers[GENERIC_TIMER_DEADLINE_NUMBER] = {NULL};
+uint8_t deadline_irq_enabled = 0;
+
+// Conversions from and to systicks
+struct timer_conversion systick_to_ns;
+struct timer_conversion systick_to_us;
+struct timer_conversion systick_to_ms;
+struct timer_conversion systick_to_ticks;
+struct timer_conversion ns_to_systick;
+struct timer_conversion us_to_systick;
+struct timer_conversion ms_to_systick;
+struct timer_conversion ticks_to_systick;
+
+/*
+ * Computes mult and shift to multiply by numerator / denominator. The shift is the
+ * biggest one (up to 64) for which mult fits in 64 bits, the error is then less
+ * than value >> shift. This is done once, so the 128-bit division is not a problem.
+ */
+void init_conversion(struct timer_conversion *conversion, uint64_t numerator, uint64_t denominator)
+{
+    uint64_t shift = 64;
+    unsigned __int128 mult;
+
+    do
+    {
+        // Round up so that exact values are not truncated to the value under
+        unsigned __int128 scaled_numerator = (unsigned __int128)numerator << shift;
+        mult = scaled_numerator / denominator + (scaled_numerator % denominator != 0);
+    } while (mult > UINT64_MAX && shift-- > 0);
+
+    conversion->mult = (uint64_t)mult;
+    conversion->shift = shift;
+}
+
+uint64_t convert(const struct timer_conversion *conversion, uint64_t value)
+{
+    return (uint64_t)(((unsigned __int128)value * conversion->mult) >> conversion->shift);
+}
+
 uint64_t generic_timer_get_freq(void)
 {
     if (cntfrq == 0)
     {
-        asm volatile("mrs %0, cntfrq_el0" : "=r"(cntfrq));
+        uint64_t frequency;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+        // Compute conversions once. An interrupt converting in the meantime computes
+        // them as well (same values), cntfrq is only set when they are all ready
+        init_conversion(&systick_to_ns, 1000000000, frequency);
+        init_conversion(&systick_to_us, 1000000, frequency);
+        init_conversion(&systick_to_ms, 1000, frequency);
+        init_conversion(&systick_to_ticks, configTICK_RATE_HZ, frequency);
+        init_conversion(&ns_to_systick, frequency, 1000000000);
+        init_conversion(&us_to_systick, frequency, 1000000);
+        init_conversion(&ms_to_systick, frequency, 1000);
+        init_conversion(&ticks_to_systick, frequency, configTICK_RATE_HZ);
+        __asm__ volatile("dmb ish" ::: "memory");
+        cntfrq = frequency;
     }
     return cntfrq;
 }
@@ -22,3 +78,125 @@ uint64_t generic_timer_read_counter(void)
 
     return cntpct;
 }
+
+/* Programs the comparator at the earliest deadline, or disarms it. Interrupts must be masked */
+void program_deadline(void)
+{
+    uint64_t earliest_deadline = 0;
+    for (int channel = 0; channel < GENERIC_TIMER_DEADLINE_NUMBER; channel++)
+    {
+        if (deadlines[channel] != 0 && (earliest_deadline == 0 || deadlines[channel] < earliest_deadline))
+        {
+            earliest_deadline = deadlines[channel];
+        }
+    }
+
+    if (earliest_deadline != 0)
+    {
+        // Compare value then enable (and unmask) the timer
+        __asm__ volatile("msr cntp_cval_el0, %0" ::"r"(earliest_deadline));
+        __asm__ volatile("msr cntp_ctl_el0, %0" ::"r"(1UL));
+    }
+    else
+    {
+        __asm__ volatile("msr cntp_ctl_el0, %0" ::"r"(0UL));
+    }
+    __asm__ volatile("isb");
+}
+
+/* Physical timer interrupt, calls the handlers of the reached deadlines */
+void deadline_irq_handler(unsigned int id)
+{
+    uint64_t current_time = generic_timer_read_counter();
+    for (int channel = 0; channel < GENERIC_TIMER_DEADLINE_NUMBER; channel++)
+    {
+        if (deadlines[channel] != 0 && deadlines[channel] <= current_time)
+        {
+            deadlines[channel] = 0;
+            if (deadline_handlers[channel] != NULL)
+            {
+                deadline_handlers[channel]();
+            }
+        }
+    }
+
+    program_deadline();
+}
+
+void generic_timer_set_deadline_handler(uint8_t channel, deadline_handler_t handler)
+{
+    deadline_handlers[channel] = handler;
+
+    if (!deadline_irq_enabled)
+    {
+        deadline_irq_enabled = 1;
+        __asm__ volatile("msr cntp_ctl_el0, %0" ::"r"(0UL));
+        irq_set_handler(PHYSICAL_TIMER_IRQ_ID, deadline_irq_handler);
+        irq_enable(PHYSICAL_TIMER_IRQ_ID);
+        irq_set_prio(PHYSICAL_TIMER_IRQ_ID, configMAX_API_CALL_INTERRUPT_PRIORITY << portPRIORITY_SHIFT);
+    }
+}
+
+void generic_timer_set_deadline(uint8_t channel, uint64_t deadline)
+{
+    UBaseType_t interrupt_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    deadlines[channel] = deadline;
+    program_deadline();
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(interrupt_mask);
+}
+
+void generic_timer_cancel_deadline(uint8_t channel)
+{
+    UBaseType_t interrupt_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    deadlines[channel] = 0;
+    program_deadline();
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(interrupt_mask);
+}
+
+uint64_t generic_timer_systick_to_ns(uint64_t systicks)
+{
+    generic_timer_get_freq();
+    return convert(&systick_to_ns, systicks);
+}
+
+uint64_t generic_timer_systick_to_us(uint64_t systicks)
+{
+    generic_timer_get_freq();
+    return convert(&systick_to_us, systicks);
+}
+
+uint64_t generic_timer_systick_to_ms(uint64_t systicks)
+{
+    generic_timer_get_freq();
+    return convert(&systick_to_ms, systicks);
+}
+
+uint64_t generic_timer_systick_to_ticks(uint64_t systicks)
+{
+    generic_timer_get_freq();
+    return convert(&systick_to_ticks, systicks);
+}
+
+uint64_t generic_timer_ns_to_systick(uint64_t time)
+{
+    generic_timer_get_freq();
+    return convert(&ns_to_systick, time);
+}
+
+uint64_t generic_timer_us_to_systick(uint64_t time)
+{
+    generic_timer_get_freq();
+    return convert(&us_to_systick, time);
+}
+
+uint64_t generic_timer_ms_to_systick(uint64_t time)
+{
+    generic_timer_get_freq();
+    return convert(&ms_to_systick, time);
+}
+
+uint64_t generic_timer_ticks_to_systick(uint64_t ticks)
+{
+    generic_timer_get_freq();
+    return convert(&ticks_to_systick, ticks);
+}
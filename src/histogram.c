@@ -0,0 +1,150 @@
+#include <histogram.h>
+#include <FreeRTOS.h>
+#include <stdio.h>
+
+/* Returns the bucket index of a value */
+uint64_t get_histogram_bucket_index(uint64_t value)
+{
+    // Small values are exact
+    if (value < HISTOGRAM_SUB_BUCKET_NUMBER)
+    {
+        return value;
+    }
+
+    // Position of the most significant bit, values too big go in the last bucket
+    uint64_t msb = 63 - __builtin_clzll(value);
+    if (msb >= HISTOGRAM_MAX_VALUE_BITS)
+    {
+        return HISTOGRAM_BUCKET_NUMBER - 1;
+    }
+
+    // Keep the HISTOGRAM_SUB_BUCKET_BITS most significant bits (the first one is always 1)
+    uint64_t shift = msb - HISTOGRAM_SUB_BUCKET_BITS + 1;
+    uint64_t sub_bucket = (value >> shift) - HISTOGRAM_HALF_SUB_BUCKET_NUMBER;
+    return HISTOGRAM_SUB_BUCKET_NUMBER + (shift - 1) * HISTOGRAM_HALF_SUB_BUCKET_NUMBER + sub_bucket;
+}
+
+/* Returns the highest value that goes in the bucket */
+uint64_t get_histogram_bucket_upper_bound(uint64_t index)
+{
+    if (index < HISTOGRAM_SUB_BUCKET_NUMBER)
+    {
+        return index;
+    }
+
+    uint64_t shift = (index - HISTOGRAM_SUB_BUCKET_NUMBER) / HISTOGRAM_HALF_SUB_BUCKET_NUMBER + 1;
+    uint64_t sub_bucket = (index - HISTOGRAM_SUB_BUCKET_NUMBER) % HISTOGRAM_HALF_SUB_BUCKET_NUMBER + HISTOGRAM_HALF_SUB_BUCKET_NUMBER;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void histogram_reset(struct histogram *histogram)
+{
+    for (int index = 0; index < HISTOGRAM_BUCKET_NUMBER; index++)
+    {
+        histogram->counts[index] = 0;
+    }
+
+    histogram->total = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+    histogram->sum = 0;
+}
+
+void histogram_record(struct histogram *histogram, uint64_t value)
+{
+    histogram->counts[get_histogram_bucket_index(value)] += 1;
+    histogram->total += 1;
+    histogram->sum += value;
+
+    if (value < histogram->min)
+    {
+        histogram->min = value;
+    }
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+uint64_t histogram_get_percentile(const struct histogram *histogram, uint64_t percentile)
+{
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+
+    // Number of values that must be under the result (rounded up)
+    uint64_t rank = (histogram->total * percentile + PERCENTILE(100) - 1) / PERCENTILE(100);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    uint64_t count = 0;
+    for (uint64_t index = 0; index < HISTOGRAM_BUCKET_NUMBER; index++)
+    {
+        count += histogram->counts[index];
+        if (count >= rank)
+        {
+            // Never more than the real max (last bucket or big buckets)
+            uint64_t value = get_histogram_bucket_upper_bound(index);
+            return value > histogram->max ? histogram->max : value;
+        }
+    }
+
+    return histogram->max;
+}
+
+/* Converts a value to print, no conversion if NULL */
+uint64_t convert_histogram_value(histogram_conversion_t conversion, uint64_t value)
+{
+    return conversion == NULL ? value : conversion(value);
+}
+
+void histogram_print_converted_percentiles(const struct histogram *histogram, const char *name, const char *unit, histogram_conversion_t conversion)
+{
+    uint64_t min = histogram->total == 0 ? 0 : histogram->min;
+
+    printf("count%s = %llu\n", name, histogram->total);
+    printf("min%s = %llu # %s\n", name, convert_histogram_value(conversion, min), unit);
+    printf("p50%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram_get_percentile(histogram, PERCENTILE(50))), unit);
+    printf("p90%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram_get_percentile(histogram, PERCENTILE(90))), unit);
+    printf("p99%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram_get_percentile(histogram, PERCENTILE(99))), unit);
+    printf("p999%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram_get_percentile(histogram, PERCENTILE(99.9))), unit);
+    printf("p9999%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram_get_percentile(histogram, PERCENTILE(99.99))), unit);
+    printf("max%s = %llu # %s\n", name, convert_histogram_value(conversion, histogram->max), unit);
+}
+
+void histogram_print_percentiles(const struct histogram *histogram, const char *name, const char *unit)
+{
+    histogram_print_converted_percentiles(histogram, name, unit, NULL);
+}
+
+void histogram_print_converted_buckets(const struct histogram *histogram, const char *name, histogram_conversion_t conversion)
+{
+    printf("histogram_bounds%s = [", name);
+    for (uint64_t index = 0; index < HISTOGRAM_BUCKET_NUMBER; index++)
+    {
+        if (histogram->counts[index] != 0)
+        {
+            printf("%llu,", convert_histogram_value(conversion, get_histogram_bucket_upper_bound(index)));
+        }
+    }
+    printf("]\n");
+
+    printf("histogram_counts%s = [", name);
+    for (uint64_t index = 0; index < HISTOGRAM_BUCKET_NUMBER; index++)
+    {
+        if (histogram->counts[index] != 0)
+        {
+            printf("%u,", histogram->counts[index]);
+        }
+    }
+    printf("]\n");
+}
+
+void histogram_print_buckets(const struct histogram *histogram, const char *name)
+{
+    histogram_print_converted_buckets(histogram, name, NULL);
+}
@@ -44,7 +44,7 @@
 
 #define configUSE_IDLE_HOOK 0
 
-#define configUSE_TICK_HOOK 1
+#define configUSE_TICK_HOOK 0
 
 #define configUSE_DAEMON_TASK_STARTUP_HOOK 0
 
@@ -58,7 +58,7 @@
 
 #define configMESSAGE_BUFFER 0
 
-#define configSUPPORT_STATIC_ALLOCATION 0
+#define configSUPPORT_STATIC_ALLOCATION 1 /* Idle and timer tasks are static (cf. main.c), xTask*CreateStatic */
 
 #define configUSE_16_BIT_TICKS 0
 
@@ -74,7 +74,10 @@
 
 #define configMINIMAL_STACK_SIZE ( ( unsigned short ) 200)
 
+/* Applications that only create static tasks can reserve less (CPPFLAGS+=-DconfigTOTAL_HEAP_SIZE=...) */
+#ifndef configTOTAL_HEAP_SIZE
 #define configTOTAL_HEAP_SIZE ( ( size_t ) ( 0x40000 ) )
+#endif
 
 #define configMAX_TASK_NAME_LEN 10
 
@@ -94,6 +97,7 @@ void vApplicationAssert( const char *pcFile, uint32_t ulLine );
 #define configUSE_QUEUE_SETS 1
 
 #define configUSE_TASK_NOTIFICATIONS 1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2 /* Index 1 releases periodic tasks (cf. release_queue.h) */
 
 #define configCHECK_FOR_STACK_OVERFLOW 2
 
@@ -103,7 +107,7 @@ void vApplicationAssert( const char *pcFile, uint32_t ulLine );
 
 #define configUSE_STATS_FORMATTING_FUNCTIONS 1
 
-#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 1 /* Index 0 is the state of periodic tasks */
 
 #define configGENERATE_RUN_TIME_STATS 0
 
@@ -111,7 +115,15 @@ void vApplicationAssert( const char *pcFile, uint32_t ulLine );
 
 #define portGET_RUN_TIME_COUNTER_VALUE()
 
+#ifdef PREM_TICKLESS
+/* Tickless idle, the armv8 port programs the next wake up as one shot (cf. port.c) */
+#define configUSE_TICKLESS_IDLE	2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+void vPortSuppressTicksAndSleep( uint64_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#else
 #define configUSE_TICKLESS_IDLE	0
+#endif
 #define configTASK_RETURN_ADDRESS    NULL
 #define INCLUDE_vTaskPrioritySet             1
 #define INCLUDE_uxTaskPriorityGet            1
@@ -123,6 +135,7 @@ void vApplicationAssert( const char *pcFile, uint32_t ulLine );
 #define INCLUDE_eTaskGetState                1
 #define INCLUDE_xTimerPendFunctionCall       1
 #define INCLUDE_pcTaskGetTaskName            1
+#define INCLUDE_xTaskGetCurrentTaskHandle    1
 #define portTICK_TYPE_IS_ATOMIC 1
 #define configMESSAGE_BUFFER_LENGTH_TYPE uint32_t
 #define configSTACK_DEPTH_TYPE uint32_t
@@ -139,6 +152,10 @@ void FreeRTOS_SetupTickInterrupt( void );
 void FreeRTOS_ClearTickInterrupt( void );
 #define configCLEAR_TICK_INTERRUPT()	FreeRTOS_ClearTickInterrupt()
 
+/* Masks the tick interrupt, then unmasks it and returns the number of missed ticks (cf. PREM_SUPPRESS_TICK) */
+void FreeRTOS_MaskTickInterrupt( void );
+uint64_t FreeRTOS_UnmaskTickInterrupt( void );
+
 #define configCOMMAND_INT_MAX_OUTPUT_SIZE 2096
 
 #define recmuCONTROLLING_TASK_PRIORITY ( configMAX_PRIORITIES - 2 )
@@ -154,6 +171,9 @@ void FreeRTOS_ClearTickInterrupt( void );
 
 // #define traceENTER_vTaskDelete( xTaskToDelete ) printf("Entered task delete\n")
 // #define traceTASK_DELETE( pxTaskToDelete ) printf("Task deleted\n")
+/* A deleted periodic task leaves the release queue and frees its id (cf. periodic_task.h) */
+void vPeriodicTaskDeleted( void *task );
+#define traceTASK_DELETE( pxTaskToDelete ) vPeriodicTaskDeleted( pxTaskToDelete )
 // #define traceRETURN_vTaskDelete() printf("Return from task delete\n")
 
 #ifdef FREERTOS_ENABLE_TRACE
@@ -2,6 +2,7 @@
 #define __BENCHMARK_H__
 
 #include <FreeRTOS.h>
+#include <histogram.h>
 
 /* Defines the measurement unit for benchmarks */
 #define MEASURE_NANO 1
@@ -10,6 +11,67 @@
 /* Defines the prototype to which benchmark functions must conform */
 typedef void (*benchmark_t)(void*);
 
+/*
+ * Benchmark context, it contains everything a benchmark needs so that more than
+ * one benchmark can be active at the same time (in different tasks or even in
+ * interrupt handlers). Declare it as you want (global, static, on the stack if
+ * the stack is big enough, the histogram is a few kB), there is no allocation.
+ *
+ * Do not modify the fields yourself, use the functions below.
+ */
+struct benchmark_ctx
+{
+    char *name;
+    int nanotime;
+    int display;
+    uint64_t last_elapsed_time;
+    unsigned __int128 square_sum;
+    struct histogram histogram;
+    const uint64_t *percentiles;
+    int percentile_number;
+#ifdef RESULT_CHANNEL
+    uint64_t stream;
+#endif
+};
+
+/*
+ * Init the benchmark context, it has the same arguments as init_benchmark and
+ * prints the same things. If more than one benchmark displays intermediate values
+ * at the same time, the printed arrays will be mixed... Only display one at a
+ * time, or use the result channel (RESULT_CHANNEL) where values are tagged.
+ */
+void benchmark_ctx_init(struct benchmark_ctx *ctx, char *benchmark_name, int use_nano, int display_intermediate);
+
+/* Runs the benchmark code, measures it and records the time in the context */
+void benchmark_ctx_run(struct benchmark_ctx *ctx, benchmark_t benchmark_code, void *benchmark_argument);
+
+/*
+ * Records an execution time (in systicks) measured by yourself. Useful when the
+ * time is measured elsewhere (the hypervisor, an interrupt handler...). This does
+ * no allocation and takes a constant time, so it can be used in an interrupt
+ * handler as long as the context does not display intermediate values.
+ */
+void benchmark_ctx_record(struct benchmark_ctx *ctx, uint64_t elapsed_time);
+
+/* Prints the results of the context, like print_benchmark_results */
+void benchmark_ctx_report(struct benchmark_ctx *ctx);
+
+/* Set the percentiles printed by the report (cf. set_benchmark_percentiles) */
+void benchmark_ctx_set_percentiles(struct benchmark_ctx *ctx, const uint64_t *benchmark_percentiles, int benchmark_percentile_number);
+
+/* Getters of a context, in the context unit (except last measured time, in ns) */
+uint64_t benchmark_ctx_get_minimum_time(struct benchmark_ctx *ctx);
+uint64_t benchmark_ctx_get_maximum_time(struct benchmark_ctx *ctx);
+uint64_t benchmark_ctx_get_average_time(struct benchmark_ctx *ctx);
+uint64_t benchmark_ctx_get_standard_deviation(struct benchmark_ctx *ctx);
+uint64_t benchmark_ctx_get_percentile_time(struct benchmark_ctx *ctx, uint64_t percentile);
+uint64_t benchmark_ctx_get_last_measured_time(struct benchmark_ctx *ctx);
+
+/*
+ * The functions below use a default context. They are here for benchmarks that
+ * only run one thing at a time.
+ */
+
 /* Get minimum execution time in ticks */
 uint64_t get_minimum_time();
 
@@ -19,6 +81,24 @@ uint64_t get_maximum_time();
 /* Get average execution time in ticks */
 uint64_t get_average_time();
 
+/* Get the standard deviation of execution times */
+uint64_t get_standard_deviation();
+
+/*
+ * Get the execution time under which [percentile] of the runs are. The percentile
+ * is in thousandths of percent, use PERCENTILE (cf. histogram.h), for example
+ * get_percentile_time(PERCENTILE(99.9)). The time comes from a histogram so it is
+ * an upper bound with a relative error of 2^-(HISTOGRAM_SUB_BUCKET_BITS - 1).
+ */
+uint64_t get_percentile_time(uint64_t percentile);
+
+/*
+ * Set the percentiles printed by print_benchmark_results. The array is not
+ * copied, so it must live until the end of benchmarks. By default p50, p90, p99
+ * and p99.9 are printed. Init resets them, so call it after init_benchmark.
+ */
+void set_benchmark_percentiles(const uint64_t *benchmark_percentiles, int benchmark_percentile_number);
+
 /*
  * Run the benchmark! It means running the code once while measuring the
  * execution time. Then computes the average time with all latter runs,
@@ -29,7 +109,7 @@ uint64_t get_average_time();
  * to check the prefetch time, you will flush the cache before or after
  * the benchmark but not during (unless you want to measure the time of
  * prefetching and then cleaning)
- * 
+ *
  * If the benchmark function requires an argument, you can give it via
  * the void* second argument
  *
@@ -46,8 +126,8 @@ void run_benchmark(benchmark_t benchmark_code, void *benchmark_argument);
  * things. You can give the benchmark a name that will be given to the
  * benchmark output variables. The name can start with _ to be better,
  * since it will be concatenated with the base variable names. You also
- * specify if you want the time in microseconds (µs) or nanoseconds 
- * (ns). If use_nano is 1, then time will be given in ns. 
+ * specify if you want the time in microseconds (µs) or nanoseconds
+ * (ns). If use_nano is 1, then time will be given in ns.
  *
  * For instance, if the name is "_color", the variable names will be
  * min_color, max_color, ...
@@ -57,15 +137,17 @@ void run_benchmark(benchmark_t benchmark_code, void *benchmark_argument);
  */
 void init_benchmark(char *benchmark_name, int use_nano, int display_intermediate);
 
-/* 
+/*
  * Returns the last measured time, or 0 if no time measured
  */
 uint64_t get_last_measured_time();
 
 /*
- * Print all times, the min, the max and the int average, ideal for a
- * copy to put it on python and compute other things that can require
- * floating points
+ * Print all times, the min, the max, the int average, the standard
+ * deviation and the percentiles, ideal for a copy to put it on python
+ * and compute other things that can require floating points. The
+ * percentiles and standard deviation are computed online, so they are
+ * also printed when intermediate values are not displayed.
  */
 void print_benchmark_results();
 
@@ -75,4 +157,4 @@ void start_benchmark();
 /* End benchmarks printing the end string */
 void end_benchmark();
 
-#endif
\ No newline at end of file
+#endif
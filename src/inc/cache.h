@@ -0,0 +1,111 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <FreeRTOS.h>
+
+/* Cache maintenance of a range (cf. cache_maintain_range) */
+#define CACHE_CLEAN_INVALIDATE 0
+#define CACHE_INVALIDATE 1
+#define CACHE_CLEAN 2
+#define CACHE_NO_MAINTENANCE 3
+
+/* Maximum number of cache levels described by CLIDR_EL1 */
+#define CACHE_MAX_LEVELS 7
+
+/* Cache types (Ctype fields of CLIDR_EL1) */
+#define CACHE_TYPE_NONE 0
+#define CACHE_TYPE_INSTRUCTION 1
+#define CACHE_TYPE_DATA 2
+#define CACHE_TYPE_SEPARATE 3
+#define CACHE_TYPE_UNIFIED 4
+
+/*
+ * Geometry of a data (or unified) cache level:
+ * - uint64_t type: CACHE_TYPE_* of the level
+ * - uint64_t line_size: size of a line (in bytes)
+ * - uint64_t line_shift: log2 of the line size
+ * - uint64_t sets: number of sets
+ * - uint64_t ways: number of ways
+ * - uint64_t size: total size (line_size * sets * ways, in bytes)
+ */
+struct cache_level
+{
+    uint64_t type;
+    uint64_t line_size;
+    uint64_t line_shift;
+    uint64_t sets;
+    uint64_t ways;
+    uint64_t size;
+};
+
+/*
+ * Cache topology of the executing core:
+ * - uint64_t level_number: number of cache levels (until the first level without cache)
+ * - uint64_t data_line_size: the smallest data cache line size of all levels (CTR_EL0.DminLine),
+ * this is the stride to use for prefetch and maintenance by address
+ * - struct cache_level levels[]: geometry of each level, levels[0] is L1
+ */
+struct cache_topology
+{
+    uint64_t level_number;
+    uint64_t data_line_size;
+    struct cache_level levels[CACHE_MAX_LEVELS];
+};
+
+/*
+ * Reads CLIDR_EL1, CCSIDR_EL1 and CTR_EL0 to fill the cache topology. This is done
+ * once at boot (in main) before main_app, so you do not need to call it. Prefetch
+ * and cache maintenance functions (cf. prefetch.h) use it, before it is called they
+ * assume 64 B lines and a 16-way L2.
+ */
+void cache_init_topology(void);
+
+/* Returns the cache topology of the executing core */
+const struct cache_topology *cache_get_topology(void);
+
+/* Returns the geometry of cache level [level] (1 for L1, ...), or NULL if there is no data cache at this level */
+const struct cache_level *cache_get_level(uint64_t level);
+
+/* Returns the data line size used for prefetch and maintenance by address */
+uint64_t cache_get_line_size(void);
+
+/*
+ * Sets the L2 sets used by this core (its colour). The set/way clean of
+ * cache_clean_range cleans these sets in all ways, so only set it if the core's
+ * data is coloured in these sets. Setting a partition enables the set/way clean
+ * from the crossover size (by default the partition size).
+ */
+void cache_set_partition(uint64_t first_set, uint64_t last_set);
+
+/* Puts the L2 partition of the core in [first_set] and [last_set], returns 0 if none is set */
+uint8_t cache_get_partition(uint64_t *first_set, uint64_t *last_set);
+
+/*
+ * Sets the data size (in bytes) from which cache_clean_range uses set/way instead
+ * of maintenance by address. The default is the partition size, where both do the
+ * same number of operations. Set/way operations are often slower, measure the real
+ * crossover with execution-cache-clear.
+ */
+void cache_set_clean_crossover(uint64_t size);
+
+/*
+ * Cleans and invalidates [address ; address + size[ in the L2. Below the crossover
+ * size (or if no partition is set), it is done by address (clear_L2_cache). Above,
+ * the core's partition is cleaned by set/way (clear_L2_cache_CISW), which does not
+ * depend on the data size. Note that set/way only maintains the L2.
+ */
+void cache_clean_range(uint64_t address, uint64_t size);
+
+/*
+ * Does [maintenance] on [address ; address + size[ in the L2:
+ * - CACHE_CLEAN_INVALIDATE: cache_clean_range
+ * - CACHE_INVALIDATE: invalidation only, for data that was not written (always by
+ * address, invalidating the partition by set/way would drop others' dirty lines).
+ * Lines only partly in the range are cleaned and invalidated, since the rest of
+ * the line can be someone else's dirty data
+ * - CACHE_CLEAN: write back only, lines stay in the cache
+ * - CACHE_NO_MAINTENANCE: nothing
+ */
+void cache_maintain_range(uint64_t address, uint64_t size, uint8_t maintenance);
+
+#endif
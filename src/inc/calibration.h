@@ -0,0 +1,44 @@
+#ifndef __CALIBRATION_H__
+#define __CALIBRATION_H__
+
+#include <FreeRTOS.h>
+#include <prem_task.h>
+
+/* Granularity of the working set discovery (in bytes) */
+#ifndef CALIBRATION_PAGE_SIZE
+#define CALIBRATION_PAGE_SIZE 0x1000
+#endif
+
+/* Number of runs per page, the minimum number of refills is kept to filter noise */
+#ifndef CALIBRATION_RUNS
+#define CALIBRATION_RUNS 2
+#endif
+
+/* Number of L2 refills above the baseline from which a page is considered used */
+#ifndef CALIBRATION_REFILL_THRESHOLD
+#define CALIBRATION_REFILL_THRESHOLD 0
+#endif
+
+/*
+ * Discovers which pages of [candidate] the computation [pxTaskCode] reads, to find
+ * the smallest PREM regions to prefetch. It uses the L2 refill PMU counter (cf.
+ * pmu.h): the whole candidate is loaded in the cache, one page is flushed and the
+ * computation is run. If it refills more lines than when nothing is flushed, the page
+ * is used. Used pages are merged in regions (at most [max_region_number]) written in
+ * [regions], and the number of regions is returned. The result is also printed with
+ * [name] so it can be pasted in the application.
+ *
+ * The computation is run (2 + pages) * CALIBRATION_RUNS times, so it must have no side
+ * effect that matters (give it the task function, not a wrapper counting its runs).
+ * Run the calibration alone on the core, before starting PREM tasks. Pages only
+ * accessed by some runs (data dependent) can be missed, calibrate with worst case
+ * inputs.
+ */
+uint64_t xPREMCalibrate(const char *name,
+                        TaskFunction_t pxTaskCode,
+                        void *pvParameters,
+                        const struct premtask_region candidate,
+                        struct premtask_region *regions,
+                        uint64_t max_region_number);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef __COLOR_H__
+#define __COLOR_H__
+
+#include <FreeRTOS.h>
+#include <prem_task.h>
+
+/*
+ * Page colors of the L2: two pages with the same color map to the same L2 sets, two
+ * pages with different colors never evict each other. There are (sets * line size)
+ * / COLOR_PAGE_SIZE colors (16 on a 1 MB 16-way L2 with 4 kB pages), cf. cache.h.
+ *
+ * Colors are computed on the addresses seen by FreeRTOS. Under Bao with cache
+ * coloring, the VM only owns some physical colors and the mapping of its pages to
+ * them must be taken into account (colors here are then "virtual" colors).
+ */
+
+/* Size of a page for coloring */
+#ifndef COLOR_PAGE_SIZE
+#define COLOR_PAGE_SIZE 0x1000
+#endif
+
+/*
+ * Size of the colored pool where color_malloc takes its pages. There is no pool by
+ * default (color_malloc returns NULL), give its size with make COLOR_POOL=size
+ * (0x80000 for instance) in applications that allocate colored pages.
+ */
+#ifndef COLOR_POOL_SIZE
+#define COLOR_POOL_SIZE 0
+#endif
+
+/* Maximum number of colors, color masks are 64-bit (above, colors are taken modulo 64) */
+#define COLOR_MAX_NUMBER 64
+
+/*
+ * Place a static buffer on a page boundary in its own section, so that its colors
+ * only depend on its size. For example:
+ * uint8_t task1_data[16 kB] COLOR_SECTION(task1);
+ */
+#define COLOR_SECTION(name) __attribute__((section(".bss.color." #name), aligned(COLOR_PAGE_SIZE)))
+
+/* Color mask with colors from [first_color] to [last_color] (included) */
+#define COLOR_MASK(first_color, last_color) ((~0ULL >> (63 - (last_color))) & (~0ULL << (first_color)))
+
+/* Returns the number of colors of the L2 */
+uint64_t color_get_number(void);
+
+/* Returns the color of [address] */
+uint64_t color_get_color(const void *address);
+
+/* Returns the mask of the colors used by [address ; address + size[ */
+uint64_t color_get_mask(const void *address, uint64_t size);
+
+/*
+ * Sets the L2 partition of the core (cf. cache_set_partition) to the sets of colors
+ * [first_color] to [last_color], a color being a range of consecutive sets. PREM
+ * does it in vInitPREM with make CACHE_COLORS=first-last.
+ */
+void color_set_cache_partition(uint64_t first_color, uint64_t last_color);
+
+/*
+ * Allocates [size] bytes of contiguous pages from the colored pool, all pages having
+ * a color of [color_mask]. Since contiguous pages have consecutive colors, the mask
+ * must contain enough consecutive colors. Returns NULL if there is no such place.
+ */
+void *color_malloc(uint64_t size, uint64_t color_mask);
+
+/*
+ * Allocates [size] bytes of pages from the colored pool, all pages having a color of
+ * [color_mask], and describes them as PREM regions (contiguous pages are merged in one
+ * region). Use it for working sets bigger than the colors of the mask, the task must
+ * then access its data through the regions. Returns the number of regions written in
+ * [regions], or 0 if there are not enough pages or more than [max_region_number]
+ * regions are needed.
+ */
+uint64_t color_malloc_regions(uint64_t size, uint64_t color_mask, struct premtask_region *regions, uint64_t max_region_number);
+
+/* Gives back pages allocated with color_malloc (or one region of color_malloc_regions) */
+void color_free(void *address, uint64_t size);
+
+#endif
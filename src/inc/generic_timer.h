@@ -4,6 +4,13 @@
 #include <FreeRTOS.h>
 #include <projdefs.h>
 
+/*
+ * The macros below do a 64-bit multiplication and a 64-bit division. They are
+ * fine for initialisation, but the multiplication overflows when the counter
+ * value is big (a few minutes of systicks for the ns conversion). In hot paths
+ * use the generic_timer_* conversion functions instead.
+ */
+
 /*
  * Converts the time in systicks to a time in nanoseconds. Be careful, this
  * result will depend on the frequency of your clock and won't be nano-second
@@ -61,10 +68,73 @@
 
 #define pdTICKS_TO_SYSTICK(sysfreq, tickCounter) (((uint64_t)(tickCounter) * (uint64_t)sysfreq) / (uint64_t)configTICK_RATE_HZ)
 
-/* Returns the frequency of the generic timer */
+/*
+ * Conversion from one unit to another: value * mult >> shift, with a 128-bit
+ * product so it never overflows. mult and shift are computed once from the
+ * generic timer frequency, with the biggest shift keeping mult on 64 bits. mult
+ * is rounded up so exact ratios (62.5 MHz -> 16 ns) give exact results, and the
+ * result is the exact (truncated) one as long as value < 2^shift / denominator
+ * (hours of systicks), then it can be one more.
+ */
+struct timer_conversion
+{
+    uint64_t mult;
+    uint64_t shift;
+};
+
+/* Returns the frequency of the generic timer (and computes conversions the first time) */
 uint64_t generic_timer_get_freq(void);
 
+/*
+ * Division-free conversions between systicks and time units (or FreeRTOS ticks).
+ * Store systicks in hot paths and convert them when reporting.
+ */
+uint64_t generic_timer_systick_to_ns(uint64_t systicks);
+uint64_t generic_timer_systick_to_us(uint64_t systicks);
+uint64_t generic_timer_systick_to_ms(uint64_t systicks);
+uint64_t generic_timer_systick_to_ticks(uint64_t systicks);
+uint64_t generic_timer_ns_to_systick(uint64_t time);
+uint64_t generic_timer_us_to_systick(uint64_t time);
+uint64_t generic_timer_ms_to_systick(uint64_t time);
+uint64_t generic_timer_ticks_to_systick(uint64_t ticks);
+
 /* Returns the count of the generic timer */
 uint64_t generic_timer_read_counter(void);
 
+/* IRQ of the EL1 physical timer (PPI 30), the FreeRTOS tick uses the virtual timer */
+#ifndef PHYSICAL_TIMER_IRQ_ID
+#define PHYSICAL_TIMER_IRQ_ID 30
+#endif
+
+/*
+ * The physical timer has one comparator, shared between deadline channels. Each
+ * channel has at most one deadline and its own handler, the comparator is programmed
+ * at the earliest one.
+ */
+#define GENERIC_TIMER_DEADLINE_PREM 0    // End of the PREM low priority (ttw)
+#define GENERIC_TIMER_DEADLINE_RELEASE 1 // Release of periodic tasks
+#define GENERIC_TIMER_DEADLINE_NUMBER 2
+
+/*
+ * Deadline handler, called in the physical timer interrupt when the deadline of its
+ * channel is reached. The deadline is cancelled before the call, so the handler can arm
+ * another one. The interrupt can call FromISR functions (it has the highest priority
+ * allowed to, configMAX_API_CALL_INTERRUPT_PRIORITY).
+ */
+typedef void (*deadline_handler_t)(void);
+
+/* Sets the handler of a channel, the first call enables the physical timer interrupt */
+void generic_timer_set_deadline_handler(uint8_t channel, deadline_handler_t handler);
+
+/*
+ * Arms the deadline of a channel, its handler is called when the counter (cf.
+ * generic_timer_read_counter) reaches [deadline]. If the deadline is already passed,
+ * it interrupts right away. Arming it again replaces the previous deadline of the channel.
+ * Can be called from a task or an interrupt handler.
+ */
+void generic_timer_set_deadline(uint8_t channel, uint64_t deadline);
+
+/* Disarms the deadline of a channel */
+void generic_timer_cancel_deadline(uint8_t channel);
+
 #endif
\ No newline at end of file
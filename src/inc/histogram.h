@@ -0,0 +1,85 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <FreeRTOS.h>
+
+/*
+ * Log-linear histogram (HDR like) to keep the distribution of a value with a fixed
+ * amount of memory. Values are put in power of 2 ranges that are each split in
+ * sub-buckets, so the relative error of a value is at most 2^-(HISTOGRAM_SUB_BUCKET_BITS - 1).
+ * For example, with 5 bits the error is at most 6.25%.
+ *
+ * Values that do not fit in HISTOGRAM_MAX_VALUE_BITS are counted in the last bucket
+ * (the maximum is still exact). You can change these values before including this
+ * header (or with CPPFLAGS) to trade memory for precision.
+ */
+#ifndef HISTOGRAM_SUB_BUCKET_BITS
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#endif
+
+#ifndef HISTOGRAM_MAX_VALUE_BITS
+#define HISTOGRAM_MAX_VALUE_BITS 32
+#endif
+
+#define HISTOGRAM_SUB_BUCKET_NUMBER (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_HALF_SUB_BUCKET_NUMBER (HISTOGRAM_SUB_BUCKET_NUMBER >> 1)
+#define HISTOGRAM_BUCKET_NUMBER (HISTOGRAM_SUB_BUCKET_NUMBER + (HISTOGRAM_MAX_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_HALF_SUB_BUCKET_NUMBER)
+
+/*
+ * Converts a percentile to the unit used by histogram_get_percentile. It works with
+ * decimals, so you can write PERCENTILE(99.9)
+ */
+#define PERCENTILE(percentile) ((uint64_t)((percentile) * 1000 + 0.5))
+
+/*
+ * Histogram structure. It does not need any allocation, you can declare it as a
+ * global variable or malloc it once and then reset it.
+ */
+struct histogram
+{
+    uint32_t counts[HISTOGRAM_BUCKET_NUMBER];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+};
+
+/* Resets the histogram, it must be done before recording values */
+void histogram_reset(struct histogram *histogram);
+
+/* Records a value in the histogram (constant time) */
+void histogram_record(struct histogram *histogram, uint64_t value);
+
+/*
+ * Returns the value under which [percentile] of the recorded values are. The
+ * percentile is in thousandths of a percent (use PERCENTILE(99.9) for instance).
+ * The result is the highest value of the bucket, so it is never under the real
+ * percentile. Returns 0 if nothing was recorded.
+ */
+uint64_t histogram_get_percentile(const struct histogram *histogram, uint64_t percentile);
+
+/*
+ * Prints the percentiles 50, 90, 99, 99.9 and 99.99, the min and the max of the
+ * histogram. Variable names are suffixed with [name] (like in the benchmarks) and
+ * [unit] is put in comment.
+ */
+void histogram_print_percentiles(const struct histogram *histogram, const char *name, const char *unit);
+
+/*
+ * Prints the non empty buckets as two arrays (upper bound of bucket and count), to
+ * rebuild the whole distribution in Python.
+ */
+void histogram_print_buckets(const struct histogram *histogram, const char *name);
+
+/* Conversion of the recorded values when printing (for instance generic_timer_systick_to_ns) */
+typedef uint64_t (*histogram_conversion_t)(uint64_t value);
+
+/*
+ * Same as histogram_print_percentiles and histogram_print_buckets, but the values
+ * are converted when printed. Record raw values (systicks) where it is time critical
+ * and convert only here.
+ */
+void histogram_print_converted_percentiles(const struct histogram *histogram, const char *name, const char *unit, histogram_conversion_t conversion);
+void histogram_print_converted_buckets(const struct histogram *histogram, const char *name, histogram_conversion_t conversion);
+
+#endif
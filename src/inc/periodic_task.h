@@ -12,13 +12,100 @@
  * Note that if the period is 0, then no waiting and this is equivalent to just having
  * a normal task. This can be useful for non periodic tasks that can be executed at any
  * time
+ *
+ * The offset (in tick, 0 by default) delays the first release of the task after the
+ * start of periodic tasks, all its releases are shifted by the offset. Spreading the
+ * offsets of tasks spreads their memory phases (cf. tools/optimize_offsets.py).
+ *
+ * The overrun policy (PERIODIC_OVERRUN_*, skip by default) tells what to do when a
+ * job ends after its deadline (the next release).
  */
 struct periodic_arguments
 {
     TickType_t tickPeriod;
     void *pvParameters;
+    TickType_t tickOffset;
+    uint8_t overrunPolicy;
+};
+
+/*
+ * Initial capacity of the registry of periodic tasks (cf. xTaskPeriodicGetHandle).
+ * The registry is a static table of this size, when more tasks are alive at the
+ * same time it doubles on the heap (and never shrinks). Ids of deleted tasks are
+ * reused, so creating and deleting tasks does not make it grow, and statically
+ * created tasks do not use the heap while at most PERIODIC_MAX_TASKS are alive. The
+ * release queue grows with it (cf. RELEASE_QUEUE_SIZE in release_queue.h), it is
+ * static as long as PERIODIC_MAX_TASKS is not bigger than RELEASE_QUEUE_SIZE.
+ */
+#ifndef PERIODIC_MAX_TASKS
+#define PERIODIC_MAX_TASKS 32
+#endif
+
+/*
+ * Private arguments of a periodic task, do not use the fields. They are here to
+ * size the buffer of a statically allocated periodic task.
+ */
+struct prv_periodic_arguments
+{
+    TaskFunction_t pxTaskCode;
+    uint64_t systick_period;
+    uint64_t systick_offset;
+    uint32_t task_id;
+    uint8_t overrun_policy;
+    uint8_t allocated;
+    void *pvParameters;
+};
+
+/*
+ * Memory of a statically allocated periodic task (cf. xTaskPeriodicCreateStatic):
+ * the FreeRTOS task and the private arguments. It must live as long as the task.
+ */
+struct periodic_task_buffer
+{
+    StaticTask_t task;
+    struct prv_periodic_arguments arguments;
+};
+
+/*
+ * Overrun policies, when a job ends after the next release:
+ * - PERIODIC_OVERRUN_SKIP: the releases that passed are skipped, the next job is
+ * released at the next period (the task keeps its phase)
+ * - PERIODIC_OVERRUN_CATCH_UP: the releases that passed are run back to back, each
+ * job keeps its release time until the task is on time again
+ * - PERIODIC_OVERRUN_DEGRADE: like skip, and the task is in degraded mode until a
+ * job ends before its deadline. A job can not be stopped from the outside (PREM
+ * computation phases run with the scheduler suspended), so the task code checks
+ * xTaskPeriodicIsDegraded and does a shorter job
+ */
+#define PERIODIC_OVERRUN_SKIP 0
+#define PERIODIC_OVERRUN_CATCH_UP 1
+#define PERIODIC_OVERRUN_DEGRADE 2
+
+/*
+ * Deadline statistics of a periodic task (deadline = next release):
+ * - uint64_t job_number: number of finished jobs
+ * - uint64_t overrun_number: number of jobs that ended after their deadline
+ * - uint64_t skipped_release_number: number of releases skipped after overruns
+ * - uint64_t max_lateness: maximum time (in systicks) between the end of a job and
+ * its deadline, 0 if no overrun
+ * - uint8_t degraded: 1 if the task is in degraded mode (PERIODIC_OVERRUN_DEGRADE)
+ */
+struct periodic_statistics
+{
+    uint64_t job_number;
+    uint64_t overrun_number;
+    uint64_t skipped_release_number;
+    uint64_t max_lateness;
+    uint8_t degraded;
 };
 
+/*
+ * Index of the thread local storage pointer of periodic tasks that points to their
+ * release and statistics (cf. get_release_time), configNUM_THREAD_LOCAL_STORAGE_POINTERS
+ * must be greater
+ */
+#define PERIODIC_RELEASE_TLS_INDEX 0
+
 /*
  * Converts a frequency in hertz to a time in ticks.
  */
@@ -27,9 +114,14 @@ struct periodic_arguments
 /*
  * Create a new periodic task and add it to the list of tasks that are ready to run.
  *
- * Repeats the given task every tickPeriod ticks. If the task runs "late", means that
- * it executes for a longer period than expected (non schedulable), the periodic task
- * will try to execute it as soon as possible...
+ * Repeats the given task every tickPeriod ticks, the first release being tickOffset
+ * ticks after the start of periodic tasks. The task is blocked between two jobs and
+ * released at the exact systick by the release queue (cf. release_queue.h), so the
+ * period is not rounded to FreeRTOS ticks. If the task runs "late", means that it
+ * executes for a longer period than expected (non schedulable), the overrun is
+ * counted (cf. xTaskPeriodicGetStatistics) and the overrun policy of the task gives
+ * the next release. With the default policy (skip), the task will try to execute it
+ * as soon as possible...
  *
  *  ┌───────┐   ┌─────
  *  │       │   │       ... Normal execution
@@ -48,8 +140,6 @@ struct periodic_arguments
  * pdFREQ_TO_TICKS to transform a frequency into ticks
  *
  * This is simply creating a task using xTaskCreate but makes it periodic.
- *
- * TODO Notify somewhere that task was not schedulable (Enable tracing?)
  */
 BaseType_t xTaskPeriodicCreate(TaskFunction_t pxTaskCode,
                                const char *const pcName,
@@ -59,10 +149,90 @@ BaseType_t xTaskPeriodicCreate(TaskFunction_t pxTaskCode,
                                TaskHandle_t *const pxCreatedTask);
 
 /*
- * Gets the last period start time with the priority
+ * Same as xTaskPeriodicCreate, but without any heap allocation (like xTaskCreateStatic):
+ * the stack ([ulStackDepth] words) and the task memory are given by the caller and
+ * must live as long as the task (global variables, for instance). Returns the task
+ * handle, or NULL if [puxStackBuffer] or [pxTaskBuffer] is NULL (or if the registry
+ * of periodic tasks is full and can not grow, cf. PERIODIC_MAX_TASKS).
  */
-TickType_t get_last_period_start(uint8_t priority);
+TaskHandle_t xTaskPeriodicCreateStatic(TaskFunction_t pxTaskCode,
+                                       const char *const pcName,
+                                       const uint32_t ulStackDepth,
+                                       const struct periodic_arguments periodic_arguments,
+                                       UBaseType_t uxPriority,
+                                       StackType_t *const puxStackBuffer,
+                                       struct periodic_task_buffer *const pxTaskBuffer);
 
+/*
+ * Gets the last period start time of the periodic task [task_id], 0 if no such task
+ */
+TickType_t get_last_period_start(uint32_t task_id);
+
+/*
+ * Returns the handle of the periodic task [task_id] (in constant time), NULL if no
+ * task has this id. Ids are given at creation, from 0, and the id of a deleted task
+ * is given to the next created task.
+ */
+TaskHandle_t xTaskPeriodicGetHandle(uint32_t task_id);
+
+/*
+ * Called when a task is deleted (traceTASK_DELETE in FreeRTOSConfig.h): removes its
+ * release from the release queue and frees its id if it is a periodic task.
+ */
+void vPeriodicTaskDeleted(void *task);
+
+/*
+ * Gets the release time (in systicks) of the running job of the calling periodic task,
+ * as given to the release queue (the nominal release, not the time the task woke up).
+ * Returns 0 if the calling task is not periodic.
+ */
+uint64_t get_release_time(void);
+
+
+/*
+ * Copies the deadline statistics of the periodic task [xTask] (NULL for the calling
+ * task) in [pxStatistics]. Returns pdFAIL if the task is not periodic.
+ */
+BaseType_t xTaskPeriodicGetStatistics(TaskHandle_t xTask, struct periodic_statistics *pxStatistics);
+
+/*
+ * Returns pdTRUE if the calling periodic task is in degraded mode (its last job
+ * ended after its deadline and its policy is PERIODIC_OVERRUN_DEGRADE).
+ */
+BaseType_t xTaskPeriodicIsDegraded(void);
+
+/*
+ * Prints the deadline statistics of the periodic task [xTask] (NULL for the calling
+ * task), suffixed with its periodic task id (jobs_task0, overruns_task0...). With
+ * MEASURE_RELEASE_LATENCY, the latency percentiles are printed as well.
+ */
+void vTaskPeriodicPrintStatistics(TaskHandle_t xTask);
+
+/*
+ * Release latencies (make RELEASE_LATENCY=y, which defines MEASURE_RELEASE_LATENCY).
+ * Each periodic task keeps two histograms (cf. histogram.h), in ns from the nominal
+ * release (cf. get_release_time):
+ * - wake up latency: until the task runs again after waiting for its release (timer
+ * interrupt and scheduler), only for releases the task waited for
+ * - start latency: until the first instruction of the job, by default when the task
+ * code is called. Wrappers that do something before the job (the PREM memory phase)
+ * give the real start with vTaskPeriodicSetJobStart, so the difference between the
+ * two latencies is the memory phase and its arbitration
+ * The histograms are in a static table indexed by the task id (about 4 kB per task,
+ * PERIODIC_MAX_TASKS tasks), not on the stack. Tasks with a bigger id (the registry
+ * grew) are not measured.
+ */
+void vTaskPeriodicSetJobStart(uint64_t job_start);
+
+/*
+ * Aligns the start of periodic tasks (the release time of offsets 0) on a multiple
+ * of [tickAlignment] ticks of the generic timer counter, which is common to all
+ * cores. With the hyperperiod of the whole taskset (or a multiple of it), offsets of
+ * tasks on different cores are relative to the same instant, even if the cores do
+ * not boot at the same time. Call it before starting the scheduler, 0 (default) starts
+ * when the first periodic task runs.
+ */
+void vPeriodicSetStartAlignment(TickType_t tickAlignment);
 
 /* 
  * Deletes the current running periodic task (for now must be non preemptive)
@@ -72,8 +242,8 @@ void vTaskPeriodicDelete(void);
 
 /*
  * This function must be called to initialise periodic tasks. If you run
- * PREM tasks, it will be already called. Call before running tasks. RUN
- * ONLY ONCE!
+ * PREM tasks, it will be already called. Call before running tasks. It does
+ * not allocate anything, and periodic tasks can be created at any time after.
  */
 void vInitPeriodic(void);
 
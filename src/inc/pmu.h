@@ -0,0 +1,31 @@
+#ifndef __PMU_H__
+#define __PMU_H__
+
+#include <FreeRTOS.h>
+
+/* Common architectural PMU events (cf. Arm ARM, PMU events) */
+#define PMU_L1D_CACHE_REFILL 0x03
+#define PMU_L1D_CACHE 0x04
+#define PMU_L2D_CACHE 0x16
+#define PMU_L2D_CACHE_REFILL 0x17
+#define PMU_BUS_ACCESS 0x19
+
+/*
+ * Enables the PMU and event counter [counter] to count [event]. The counter is
+ * reset. Counters are numbered from 0 to PMCR_EL0.N - 1 (6 on Cortex A72).
+ *
+ * The hypervisor must let the guest access the PMU (MDCR_EL2.TPM cleared),
+ * otherwise this traps.
+ */
+void pmu_enable_counter(uint64_t counter, uint64_t event);
+
+/* Disables event counter [counter] */
+void pmu_disable_counter(uint64_t counter);
+
+/* Resets event counter [counter] to 0 */
+void pmu_reset_counter(uint64_t counter);
+
+/* Returns the value of event counter [counter] */
+uint64_t pmu_read_counter(uint64_t counter);
+
+#endif
@@ -4,8 +4,11 @@
 // TODO Documentation
 
 void clear_L2_cache(uint64_t address, uint64_t size);
+void invalidate_L2_cache(uint64_t address, uint64_t size);
+void clean_L2_cache(uint64_t address, uint64_t size);
 void clear_L2_cache_CISW(uint64_t first_way, uint64_t last_way, uint64_t first_set, uint64_t last_set);
 void prefetch_data(uint64_t address, uint64_t size);
 void prefetch_data_prem(uint64_t address, uint64_t size, volatile uint8_t* suspend_prefetch);
+void touch_data_prem(uint64_t address, uint64_t size, volatile uint8_t* suspend_prefetch);
 
 #endif
\ No newline at end of file
@@ -1,17 +1,14 @@
 #ifndef __PREFETCH_INC_H__
 #define __PREFETCH_INC_H__
 
-#if defined(PLATFORM) && PLATFORM == rpi4
-    #define L2_CACHE_SIZE 0x100000
-#else
-    #define L2_CACHE_SIZE L2_BLOCK_SIZE
-#endif
+// Cache size, line size and sets/ways are discovered at boot, cf. cache.h
 
-#define D_MIN_LINE_OFF  16
-#define D_MIN_LINE_LEN  4
-#define WORD_SIZE       4
+// Number of lines prefetched (or maintained) per iteration of the unrolled loops
+#define PREFETCH_UNROLL         8
 
-#define L2_CACHE_LINE_SIZE      64
-#define LOG2_L2_CACHE_LINE_SIZE 6
+// Number of lines prefetched between two suspend checks in PREM prefetch (max 65535)
+#ifndef PREFETCH_CHECK_LINES
+    #define PREFETCH_CHECK_LINES 64
+#endif
 
 #endif
\ No newline at end of file
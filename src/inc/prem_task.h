@@ -3,21 +3,63 @@
 
 #include <FreeRTOS.h>
 #include <task.h>
+#include <periodic_task.h>
+#include <histogram.h>
+
+/* Access of a PREM task to a region, it selects the cache maintenance after the job */
+#define PREM_ACCESS_READ_WRITE 0
+#define PREM_ACCESS_READ_ONLY 1
+
+/*
+ * Memory region prefetched during the memory phase of a PREM task:
+ * - void *data: the start of the region. It will internally be considered as
+ * a uint8_t array of size [data_size]
+ * - uint64_t data_size: the size of the region (in bytes)
+ * - uint8_t access: how the task accesses the region (PREM_ACCESS_*, read-write
+ * by default). After the job, written regions are cleaned and invalidated and
+ * read-only regions are only invalidated
+ * - uint8_t keep_warm: if not 0, lines stay in the cache after the job. Written
+ * regions are only cleaned and read-only regions are not maintained at all. With
+ * residency tracking (make RESIDENCY=y, cf. residency.h), the next memory phase
+ * only prefetches what is not still in the cache
+ */
+struct premtask_region
+{
+    void *data;
+    uint64_t data_size;
+    uint8_t access;
+    uint8_t keep_warm;
+};
 
 /*
  * Structure that contains important data for the PREM task:
  * - TickType_t tickPeriod: the task's period (in FreeRTOS ticks). A tick
  * period of 0 means that there is no waiting time and that the task ask directly
  * for a new memory period
+ * - TickType_t tickOffset: the release offset of the task (in FreeRTOS ticks, cf.
+ * struct periodic_arguments). Offsets given by tools/optimize_offsets.py spread the
+ * memory phases of the taskset and reduce the time waiting for the memory token
+ * - uint8_t overrunPolicy: what to do when a job ends after the next release
+ * (PERIODIC_OVERRUN_*, cf. periodic_task.h)
  * - uint64_t data_size: the size of the data to prefetch (in bytes)
  * - void *data: the data array to prefetch. It will internally be considered as
  * a uint8_t array of size [data_size]
+ * - uint8_t data_access, data_keep_warm: the access and keep_warm of [data] (cf.
+ * struct premtask_region)
  * - uint64_t wcet: Worst case execution time. Time must be in NANOSECONDS, conversion
  * to systicks will be done internally.
  * - void *pvParameters: the argument(s) of the task.
+ * - uint64_t region_number: the number of regions in [regions]. If 0, then the
+ * task only has one region described by [data] and [data_size]
+ * - const struct premtask_region *regions: the list of regions to prefetch. They
+ * are prefetched one after the other under the same memory access, and cleared
+ * after the computation phase. Use it when the task touches disjoint arrays, so
+ * you don't need to prefetch everything in between. When used, [data] and
+ * [data_size] are ignored.
  *
  * Note that you do not need to malloc the struct is as it will be malloc'ed
- * and freed in xTaskPREMCreate.
+ * and freed in xTaskPREMCreate (or copied in the buffer of xTaskPREMCreateStatic).
+ * The region list is copied as well, so it can be a local variable.
  */
 struct premtask_parameters
 {
@@ -26,6 +68,12 @@ struct premtask_parameters
     void *data;
     uint64_t wcet;
     void *pvParameters;
+    uint64_t region_number;
+    const struct premtask_region *regions;
+    uint8_t data_access;
+    uint8_t data_keep_warm;
+    TickType_t tickOffset;
+    uint8_t overrunPolicy;
 };
 
 /* Answer of hypervisor after a memory request */
@@ -39,6 +87,66 @@ union memory_request_answer
     uint64_t raw;
 };
 
+/*
+ * PREM control block, one per PREM task. It contains the arbitration state of the
+ * task's current job, so that a preempted task keeps its own answer:
+ * - union memory_request_answer memory_access: last answer of the hypervisor
+ * - uint64_t end_low_prio: time (in systicks) at which the ttw ends, 0 if none
+ * - uint8_t suspend_prefetch: 1 if the memory phase must be suspended
+ * - uint64_t wcet: worst case execution time (in systicks) sent with the request
+ * - uint64_t release_time, memory_phase_start, computation_phase_start, end_time:
+ * timestamps (in systicks) of the phases of the current job
+ */
+struct prem_control_block
+{
+    volatile union memory_request_answer memory_access;
+    volatile uint64_t end_low_prio;
+    volatile uint8_t suspend_prefetch;
+    uint64_t wcet;
+    uint64_t release_time;
+    uint64_t memory_phase_start;
+    uint64_t computation_phase_start;
+    uint64_t end_time;
+};
+
+/*
+ * PREM task parameters that are really used in the task. Do not use the fields, they
+ * are here to size the buffer of a statically allocated PREM task. With
+ * MEASURE_RESPONSE_TIME, the task keeps its response time histogram (in systicks,
+ * converted to ns when displayed, the first response is not recorded).
+ */
+struct prv_premtask_parameters
+{
+    TaskFunction_t pxTaskCode;
+    uint8_t task_id;
+    uint8_t allocated;
+    void *pvParameters;
+    uint64_t color_mask; // L2 colors of the regions
+    struct prem_control_block control_block;
+#ifdef MEASURE_RESPONSE_TIME
+    struct histogram response_histogram;
+    uint64_t response_number;
+#endif
+    uint64_t region_number;
+    struct premtask_region *regions; // Allocated with the struct, or in the static buffer
+};
+
+/* Maximum number of regions of a statically allocated PREM task */
+#ifndef PREM_STATIC_MAX_REGIONS
+#define PREM_STATIC_MAX_REGIONS 16
+#endif
+
+/*
+ * Memory of a statically allocated PREM task (cf. xTaskPREMCreateStatic): the periodic
+ * task, the PREM parameters and a copy of the regions. It must live as long as the task.
+ */
+struct premtask_buffer
+{
+    struct periodic_task_buffer periodic;
+    struct prv_premtask_parameters parameters;
+    struct premtask_region regions[PREM_STATIC_MAX_REGIONS];
+};
+
 /*
  * Delays the PREM task of [waitingTicks] ticks. (Systicks ticks)
  *
@@ -100,12 +208,31 @@ BaseType_t xTaskPREMCreate(TaskFunction_t pxTaskCode,
                            UBaseType_t uxPriority,
                            TaskHandle_t *const pxCreatedTask);
 
+/*
+ * Same as xTaskPREMCreate, but without any heap allocation (cf. xTaskPeriodicCreateStatic):
+ * the stack ([ulStackDepth] words) and the task memory are given by the caller and must
+ * live as long as the task. The regions are copied in the buffer, so there can be at most
+ * PREM_STATIC_MAX_REGIONS of them. Returns the task handle, or NULL if [puxStackBuffer]
+ * or [pxTaskBuffer] is NULL.
+ */
+TaskHandle_t xTaskPREMCreateStatic(TaskFunction_t pxTaskCode,
+                                   const char *const pcName,
+                                   const uint32_t ulStackDepth,
+                                   const struct premtask_parameters premtask_parameters,
+                                   UBaseType_t uxPriority,
+                                   StackType_t *const puxStackBuffer,
+                                   struct premtask_buffer *const pxTaskBuffer);
+
 /*
  * Deletes the PREM task. If time is measured, it will send one hypercall with 4 values:
  * - The core id
  * - The task id
  * - The max response time
  * - The sum of all response times (for average)
+ *
+ * It also prints the response time percentiles (p50, p90, p99, p99.9, p99.99) that
+ * are kept in a histogram (cf. histogram.h). Define DISPLAY_RESPONSE_HISTOGRAM to
+ * print the whole histogram as well.
  * 
  * This will call the vTaskPeriodicDelete function.
  */
@@ -119,7 +246,8 @@ void askDisplayResults(void);
 
 /*
  * Asks for the change of the prefetch size. The change will be effective from the next
- * execution onwards (unless another change is requested).
+ * execution onwards (unless another change is requested). If the task has multiple
+ * regions, only the size of the first one is changed.
  */
 void askChangePrefetchSize(uint64_t new_size);
 
@@ -129,6 +257,12 @@ void askChangePrefetchSize(uint64_t new_size);
  * function will enable IPI and implement handlers for you! Running this function more
  * than once is useless... You can of course run PREM task without it, but do not exepect
  * IPI and if your task gets suspended, it's for the rest of its life.
+ *
+ * With make CACHE_COLORS=first-last (the physical L2 colors of the VM in the Bao
+ * config, they must be consecutive), it also sets the L2 partition of the core (cf.
+ * cache_set_partition) so that regions bigger than the crossover are cleaned by
+ * set/way after the job. CLEAN_CROSSOVER=size (in bytes, measured by
+ * execution-cache-clear) changes the crossover, the partition size by default.
  */
 void vInitPREM();
 
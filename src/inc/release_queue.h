@@ -0,0 +1,58 @@
+#ifndef __RELEASE_QUEUE_H__
+#define __RELEASE_QUEUE_H__
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+/*
+ * Initial number of tasks that can wait for their release at the same time (static),
+ * the queue grows with the registry of periodic tasks (cf. release_queue_reserve)
+ */
+#ifndef RELEASE_QUEUE_SIZE
+#define RELEASE_QUEUE_SIZE 64
+#endif
+
+/*
+ * Index of the task notification used to release tasks, do not use it in the task
+ * code (configTASK_NOTIFICATION_ARRAY_ENTRIES must be greater)
+ */
+#define RELEASE_QUEUE_NOTIFICATION 1
+
+/*
+ * The release queue is a min-heap of release times served by the physical timer
+ * (cf. generic_timer_set_deadline). The comparator is programmed at the earliest
+ * release, and all the tasks released at the same time are woken up in the same
+ * interrupt. Periodic tasks use it between their jobs.
+ *
+ * A release is owned by its task (on its stack for instance) and must live while
+ * the task waits.
+ */
+struct release
+{
+    uint64_t release_time;
+    TaskHandle_t task;
+};
+
+/* Sets the physical timer handler of the release queue, call it before waiting */
+void release_queue_init(void);
+
+/*
+ * Blocks the calling task until the counter reaches the release time of [release].
+ * If the release time is already passed, it returns right away.
+ */
+void release_queue_wait(struct release *release);
+
+/*
+ * Makes room for [size] tasks waiting at the same time, the queue only grows (on the
+ * heap). The registry of periodic tasks calls it when it grows, so that all periodic
+ * tasks can wait at the same time. Returns pdFAIL if there is not enough memory.
+ */
+BaseType_t release_queue_reserve(uint32_t size);
+
+/*
+ * Removes the releases of [task] from the queue. It is called when a task is deleted
+ * (cf. vPeriodicTaskDeleted in periodic_task.h), so a task can be deleted while it waits.
+ */
+void release_queue_remove_task(void *task);
+
+#endif
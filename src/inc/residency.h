@@ -0,0 +1,94 @@
+#ifndef __RESIDENCY_H__
+#define __RESIDENCY_H__
+
+#include <FreeRTOS.h>
+
+/* Maximum number of ranges known to be in the L2 of the core */
+#ifndef RESIDENCY_MAX_ENTRIES
+#define RESIDENCY_MAX_ENTRIES 16
+#endif
+
+/*
+ * Ways of each L2 set kept for the lines that the computation itself uses (stack,
+ * code since the L2 is unified, data that is not in a region). Tracked ranges only
+ * use the other ways.
+ */
+#ifndef RESIDENCY_RESERVED_WAYS
+#define RESIDENCY_RESERVED_WAYS 2
+#endif
+
+/*
+ * Number of L2 colors of the VM (cf. color.h). Under Bao cache coloring, the pages
+ * of the VM only go in the sets of its colors, so a range puts more lines in each of
+ * these sets than its size over the L2 size. By default it is the number of colors
+ * of make CACHE_COLORS=first-last, or 1 if not given (the worst case).
+ */
+#ifndef RESIDENCY_VM_COLORS
+#ifdef PREM_CACHE_FIRST_COLOR
+#define RESIDENCY_VM_COLORS (PREM_CACHE_LAST_COLOR - PREM_CACHE_FIRST_COLOR + 1)
+#else
+#define RESIDENCY_VM_COLORS 1
+#endif
+#endif
+
+/*
+ * The residency tracker remembers which ranges were loaded in the L2 of this core
+ * and were not evicted since, so that a PREM memory phase can skip what is already
+ * there (enable it with PREM_RESIDENCY_TRACKING, make RESIDENCY=y).
+ *
+ * It is conservative as long as RESIDENCY_VM_COLORS is not more than the colors of
+ * the VM and RESIDENCY_RESERVED_WAYS covers what the computation uses outside of the
+ * regions. Everything is forgotten when:
+ * - loading a range could evict another one (the ranges would need more lines in a
+ * set of the VM colors than the ways left after RESIDENCY_RESERVED_WAYS). The PREM
+ * memory phase checks this for all the loads of the job before skipping anything
+ * (cf. residency_can_load), and loads everything again if the tracker forgot
+ * everything while it was loading
+ * - a PREM task preempts another one
+ * - a set/way maintenance is done (cf. cache_clean_range)
+ * and a range is forgotten when it is invalidated by address (cf. cache_maintain_range).
+ * Code that evicts lines otherwise (a non-PREM task streaming through memory, a call
+ * to clear_L2_cache...) must call residency_invalidate_all.
+ *
+ * A prfm is a hint and the line can be dropped, a range loaded with prefetch_data_prem
+ * is considered loaded anyway. Use MEMORY_PHASE=touch for a guarantee.
+ */
+
+/* Forgets all ranges */
+void residency_invalidate_all(void);
+
+/* Forgets all ranges that overlap [address ; address + size[ */
+void residency_invalidate_range(uint64_t address, uint64_t size);
+
+/* Returns the number of ways (lines in the same set) that a range of [size] bytes counts for */
+uint64_t residency_get_ways(uint64_t size);
+
+/*
+ * Returns 1 if [range_number] ranges using [ways] ways in total (cf. residency_get_ways)
+ * can be loaded and recorded without evicting a recorded range. A memory phase that
+ * skips recorded ranges must check it for all its loads before skipping anything:
+ * if they do not fit, forget everything and load everything.
+ */
+uint8_t residency_can_load(uint64_t ways, uint64_t range_number);
+
+/*
+ * Returns the generation of the tracker, it changes each time everything is
+ * forgotten. Get it before loading a range and give it to residency_mark_loaded,
+ * so that a range that was evicted while loading is not recorded.
+ */
+uint64_t residency_get_generation(void);
+
+/*
+ * Records that [address ; address + size[ is in the L2, unless the generation
+ * changed since [generation] was taken.
+ */
+void residency_mark_loaded(uint64_t address, uint64_t size, uint64_t generation);
+
+/*
+ * Returns the size of the part of [address ; address + size[ that still needs to be
+ * loaded and puts its start in [missing_address]. Ranges that cover the start or the
+ * end of the range shrink it, 0 means that everything is already there.
+ */
+uint64_t residency_get_missing(uint64_t address, uint64_t size, uint64_t *missing_address);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef __RESULT_CHANNEL_H__
+#define __RESULT_CHANNEL_H__
+
+#include <FreeRTOS.h>
+
+/*
+ * Binary result channel: measured values are written as fixed-size records in a
+ * ring buffer instead of being printed on the UART. Writing a record is just a
+ * few stores, so it does not perturb what is measured.
+ *
+ * The ring buffer can be:
+ * - in a Bao shared memory region (RESULT_CHANNEL=shmem RESULT_CHANNEL_ADDR=0x...),
+ * the host (or another guest) reads records and increments read_index.
+ * - in the guest memory and written to a file with semihosting when draining
+ * (RESULT_CHANNEL=semihosting, for QEMU with -semihosting).
+ *
+ * This is only compiled when RESULT_CHANNEL is defined (the Makefile does it).
+ *
+ * Records contain raw systicks, the header contains the timer frequency. Use the
+ * tools/decode_results.py script to get the results in the same format as the
+ * benchmark prints.
+ */
+
+/* Magic number and version of the channel header ("PREM") */
+#define RESULT_CHANNEL_MAGIC 0x4D455250
+#define RESULT_CHANNEL_VERSION 1
+
+/* Number of records of the ring buffer, must be a power of 2 */
+#ifndef RESULT_CHANNEL_CAPACITY
+#define RESULT_CHANNEL_CAPACITY 4096
+#endif
+
+/*
+ * Flag of the stream of records containing the name of a stream (a stream is a
+ * named array of values). Names are written 8 characters per record, the last
+ * record contains the end of string.
+ */
+#define RESULT_CHANNEL_NAME_RECORD (1ULL << 63)
+
+/* Name of the file written with semihosting */
+#ifndef RESULT_CHANNEL_FILE
+#define RESULT_CHANNEL_FILE "results.bin"
+#endif
+
+/* A record, the value is in systicks (or part of a name) */
+struct result_record
+{
+    uint64_t stream;
+    uint64_t value;
+};
+
+/*
+ * Header of the channel, followed by the records. With semihosting, each drain
+ * writes a copy of the header (with a capacity of 0) followed by the drained
+ * records.
+ */
+struct result_channel_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency;
+    uint64_t capacity;
+    volatile uint64_t write_index;
+    volatile uint64_t read_index;
+    volatile uint64_t dropped;
+};
+
+/*
+ * Opens a new stream with the given name and returns its id. The name is written
+ * in the channel so do not call it in measured windows. The channel is initialised
+ * at the first call.
+ */
+uint64_t result_channel_open(const char *name);
+
+/*
+ * Writes a value in the stream. If the ring buffer is full, the value is dropped
+ * and counted in the header. Call it in measured windows, it never blocks.
+ */
+void result_channel_write(uint64_t stream, uint64_t value);
+
+/* Returns the number of records that have not been read yet */
+uint64_t result_channel_pending(void);
+
+/*
+ * Drains the records. With semihosting they are written to the file, with shared
+ * memory it does nothing since the reader is on the other side. Call it outside
+ * measured windows!
+ */
+void result_channel_drain(void);
+
+#endif
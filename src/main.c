@@ -38,6 +38,7 @@
 #include <prefetch.h>
 #include <state_machine.h>
 #include <ipi.h>
+#include <cache.h>
 
 /*
  * Prototypes for the standard FreeRTOS callback/hook functions implemented
@@ -47,6 +48,14 @@ void vApplicationMallocFailedHook(void);
 void vApplicationIdleHook(void);
 void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName);
 void vApplicationTickHook(void);
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize);
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize);
+
+/* Memory of the idle and timer tasks, so that the kernel does not allocate them */
+StaticTask_t idle_task_buffer;
+StackType_t idle_task_stack[configMINIMAL_STACK_SIZE];
+StaticTask_t timer_task_buffer;
+StackType_t timer_task_stack[configTIMER_TASK_STACK_DEPTH];
 
 /* Application main */
 extern void main_app(void);
@@ -55,6 +64,9 @@ extern void main_app(void);
 
 int main(void)
 {
+    // Prefetch and cache maintenance need the cache geometry
+    cache_init_topology();
+
     main_app();
 
     return 0;
@@ -110,6 +122,25 @@ void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
 }
 /*-----------------------------------------------------------*/
 
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize)
+{
+    /* configSUPPORT_STATIC_ALLOCATION is set to 1, so the kernel asks for the
+    memory of the idle task instead of allocating it. */
+    *ppxIdleTaskTCBBuffer = &idle_task_buffer;
+    *ppxIdleTaskStackBuffer = idle_task_stack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
+{
+    /* Same for the timer task (configUSE_TIMERS is set to 1). */
+    *ppxTimerTaskTCBBuffer = &timer_task_buffer;
+    *ppxTimerTaskStackBuffer = timer_task_stack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+/*-----------------------------------------------------------*/
+
 void vAssertCalled(void)
 {
     volatile uint32_t ulSetTo1ToExitFunction = 0;
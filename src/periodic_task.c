@@ -2,21 +2,171 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <generic_timer.h>
+#include <release_queue.h>
+#include <histogram.h>
+#include <stdio.h>
 
-struct prv_periodic_arguments
+#ifdef MEASURE_RELEASE_LATENCY
+/* Release latencies of a periodic task (in systicks), too big for the stack of a task */
+struct periodic_latencies
 {
-    TaskFunction_t pxTaskCode;
-    uint64_t systick_period;
-    uint8_t task_id;
-    void *pvParameters;
+    struct histogram wakeup_latencies;
+    struct histogram start_latencies;
 };
 
-uint8_t periodic_task_number = 0;
+// Latencies of the tasks whose id is under PERIODIC_MAX_TASKS, indexed by id
+struct periodic_latencies release_latencies[PERIODIC_MAX_TASKS];
+#endif
+
+/*
+ * State of a periodic task, on its stack and pointed by its thread local storage
+ * pointer (cf. get_release_time, xTaskPeriodicGetStatistics)
+ */
+struct periodic_task_state
+{
+    struct release release;
+    struct periodic_statistics statistics;
+    uint32_t task_id;
+    uint8_t overrun_policy;
+#ifdef MEASURE_RELEASE_LATENCY
+    uint64_t wakeup_time;
+    uint64_t job_start;
+    struct periodic_latencies *latencies; // NULL if not measured
+#endif
+};
+
+/* Records the wake up latency of the task (it just woke up for its release) */
+void record_wakeup(struct periodic_task_state *state)
+{
+#ifdef MEASURE_RELEASE_LATENCY
+    state->wakeup_time = generic_timer_read_counter();
+    if (state->latencies != NULL)
+    {
+        histogram_record(&state->latencies->wakeup_latencies, state->wakeup_time - state->release.release_time);
+    }
+#endif
+}
+
+/*
+ * Entry of the registry of periodic tasks, the task id is its index. A free entry
+ * is in the list of free entries, so ids of deleted tasks are reused.
+ */
+struct periodic_registry_entry
+{
+    TaskHandle_t task;
+    uint64_t last_period_start;
+    uint32_t next_free;
+    uint8_t used;
+};
+
+#define PERIODIC_REGISTRY_NO_ENTRY UINT32_MAX
+
+// The registry starts in a static table and grows from the heap when all entries are used
+struct periodic_registry_entry static_registry[PERIODIC_MAX_TASKS];
+struct periodic_registry_entry *periodic_registry = static_registry;
+uint32_t periodic_registry_size = PERIODIC_MAX_TASKS;
+uint32_t periodic_registry_used = 0; // Entries used at least once
+uint32_t periodic_registry_free = PERIODIC_REGISTRY_NO_ENTRY; // First free entry
+
 uint64_t starting_tick = 0;
-uint64_t *last_period_start; // Array containing all last periods
+uint64_t start_alignment = 0; // In systicks, 0 if not aligned
 
 uint8_t kill_periodic_task = 0; // 1 if needs to be killed
 
+/* Takes a free entry of the registry, or returns PERIODIC_REGISTRY_NO_ENTRY if full. Interrupts must be masked */
+uint32_t periodic_registry_take(void)
+{
+    uint32_t task_id = PERIODIC_REGISTRY_NO_ENTRY;
+    if (periodic_registry_free != PERIODIC_REGISTRY_NO_ENTRY)
+    {
+        task_id = periodic_registry_free;
+        periodic_registry_free = periodic_registry[task_id].next_free;
+    }
+    else if (periodic_registry_used < periodic_registry_size)
+    {
+        task_id = periodic_registry_used++;
+    }
+
+    if (task_id != PERIODIC_REGISTRY_NO_ENTRY)
+    {
+        periodic_registry[task_id].task = NULL;
+        periodic_registry[task_id].last_period_start = 0;
+        periodic_registry[task_id].used = 1;
+    }
+    return task_id;
+}
+
+/* Puts back the entry [task_id] in the free list. Interrupts must be masked */
+void periodic_registry_release(uint32_t task_id)
+{
+    if (task_id < periodic_registry_used && periodic_registry[task_id].used)
+    {
+        periodic_registry[task_id].used = 0;
+        periodic_registry[task_id].task = NULL;
+        periodic_registry[task_id].next_free = periodic_registry_free;
+        periodic_registry_free = task_id;
+    }
+}
+
+/*
+ * Returns a free task id, the registry is doubled if it is full (the only heap
+ * allocation of the registry). Returns PERIODIC_REGISTRY_NO_ENTRY if it can not grow.
+ */
+uint32_t periodic_registry_allocate(void)
+{
+    // The static registry can be bigger than the static release queue
+    if (release_queue_reserve(periodic_registry_size) != pdPASS)
+    {
+        return PERIODIC_REGISTRY_NO_ENTRY;
+    }
+
+    taskENTER_CRITICAL();
+    uint32_t task_id = periodic_registry_take();
+    taskEXIT_CRITICAL();
+
+    if (task_id == PERIODIC_REGISTRY_NO_ENTRY)
+    {
+        // All the periodic tasks must be able to wait for their release at the same time
+        uint32_t new_size = periodic_registry_size * 2;
+        if (release_queue_reserve(new_size) != pdPASS)
+        {
+            return PERIODIC_REGISTRY_NO_ENTRY;
+        }
+
+        struct periodic_registry_entry *new_registry = (struct periodic_registry_entry *)pvPortMalloc(sizeof(struct periodic_registry_entry) * new_size);
+        if (new_registry == NULL)
+        {
+            return PERIODIC_REGISTRY_NO_ENTRY;
+        }
+
+        // Tasks can update their entry in the meantime, copy and switch at once
+        taskENTER_CRITICAL();
+        struct periodic_registry_entry *old_registry = periodic_registry;
+        for (uint32_t index = 0; index < periodic_registry_used; index++)
+        {
+            new_registry[index] = old_registry[index];
+        }
+        periodic_registry = new_registry;
+        periodic_registry_size = new_size;
+        task_id = periodic_registry_take();
+        taskEXIT_CRITICAL();
+
+        if (old_registry != static_registry)
+        {
+            vPortFree(old_registry);
+        }
+    }
+
+    return task_id;
+}
+
+void set_last_period_start(uint32_t task_id, uint64_t period_start)
+{
+    taskENTER_CRITICAL();
+    periodic_registry[task_id].last_period_start = period_start;
+    taskEXIT_CRITICAL();
+}
+
 /* The periodic task */
 void vPeriodicTask(void *pvParameters)
 {
@@ -24,27 +174,68 @@ void vPeriodicTask(void *pvParameters)
     if (starting_tick == 0)
     {
         starting_tick = generic_timer_read_counter();
+
+        // Start on the next multiple of the alignment, the same for all cores
+        if (start_alignment != 0)
+        {
+            starting_tick = (starting_tick / start_alignment + 1) * start_alignment;
+        }
     }
 
     // Getting struct from task parameters and extract task function, period and parameters
     struct prv_periodic_arguments *periodic_arguments = (struct prv_periodic_arguments *)pvParameters;
 
     TaskFunction_t pxTaskCode = periodic_arguments->pxTaskCode;
-    uint8_t task_id = periodic_arguments->task_id;
+    uint32_t task_id = periodic_arguments->task_id;
     void *pvTaskParameters = periodic_arguments->pvParameters;
 
     const uint64_t tickPeriod = periodic_arguments->systick_period;
+    const uint64_t tickOffset = periodic_arguments->systick_offset;
 
-    // Don't forget to free the struct
-    vPortFree(pvParameters);
+    // Initialise the release with the starting ticks and the offset, the running job can get it (cf. get_release_time)
+    struct periodic_task_state state = {.release = {.release_time = starting_tick + tickOffset, .task = NULL},
+                                        .statistics = {0},
+                                        .task_id = task_id,
+                                        .overrun_policy = periodic_arguments->overrun_policy};
+    struct release *release = &state.release;
+    vTaskSetThreadLocalStoragePointer(NULL, PERIODIC_RELEASE_TLS_INDEX, &state);
+#ifdef MEASURE_RELEASE_LATENCY
+    // The latencies of the previous task with this id are lost
+    state.latencies = task_id < PERIODIC_MAX_TASKS ? &release_latencies[task_id] : NULL;
+    if (state.latencies != NULL)
+    {
+        histogram_reset(&state.latencies->wakeup_latencies);
+        histogram_reset(&state.latencies->start_latencies);
+    }
+#endif
+    set_last_period_start(task_id, release->release_time);
+
+    // Don't forget to free the struct (if not statically allocated)
+    if (periodic_arguments->allocated)
+    {
+        vPortFree(pvParameters);
+    }
 
-    // Initialise the last_period_start variable with the starting ticks.
-    last_period_start[task_id] = starting_tick;
+    // Wait for the first release (aligned start or offset)
+    if (generic_timer_read_counter() < release->release_time)
+    {
+        release_queue_wait(release);
+        record_wakeup(&state);
+    }
 
     while (1)
     {
-        // Execute task
+        // Execute task, the task code can say where the job really starts (cf. vTaskPeriodicSetJobStart)
+#ifdef MEASURE_RELEASE_LATENCY
+        state.job_start = generic_timer_read_counter();
+#endif
         pxTaskCode(pvTaskParameters);
+#ifdef MEASURE_RELEASE_LATENCY
+        if (state.latencies != NULL)
+        {
+            histogram_record(&state.latencies->start_latencies, state.job_start - release->release_time);
+        }
+#endif
 
         // If delete function called during code execution...
         if (kill_periodic_task)
@@ -54,57 +245,97 @@ void vPeriodicTask(void *pvParameters)
             vTaskDelete(NULL);
         }
 
+        state.statistics.job_number++;
+
         // If period is 0, then no waiting
         if (tickPeriod != 0)
         {
             // Get current tick count
             uint64_t currentTick = generic_timer_read_counter();
-            uint64_t next_period_start = last_period_start[task_id] + tickPeriod;
-
-            // If a new cycle didn't start yet, then delay
-            if (currentTick < next_period_start)
-            {
-                // Put the task into WAIT state, so compute the number of FreeRTOS cycles to wait
-                vTaskDelay(pdSYSTICK_TO_TICKS(generic_timer_get_freq(), next_period_start - currentTick));
-
-                // The pdSYSTICK_TO_TICKS gives an underestimation of the number of cycles to wait...
-                // So wait for the remaining number of systicks
-                while (currentTick < next_period_start)
-                {
-                    currentTick = generic_timer_read_counter();
-                }
-            }
+            uint64_t next_period_start = release->release_time + tickPeriod;
 
             // When the current cycle is greater than the period, it gets tricky...
             // It means that the task exceeded its dead line...
-            // We search for its next period...
-            else if (currentTick > next_period_start)
+            if (currentTick > next_period_start)
             {
-                // We loop until the current tick is smaller than the next period
-                while (currentTick > next_period_start)
+                uint64_t lateness = currentTick - next_period_start;
+                state.statistics.overrun_number++;
+                if (lateness > state.statistics.max_lateness)
                 {
-                    next_period_start += tickPeriod;
+                    state.statistics.max_lateness = lateness;
                 }
 
-                // Put the task into WAIT state, so compute the number of FreeRTOS cycles to wait
-                vTaskDelay(pdSYSTICK_TO_TICKS(generic_timer_get_freq(), next_period_start - currentTick));
-
-                // The pdSYSTICK_TO_TICKS gives an underestimation of the number of cycles to wait...
-                // So wait for the remaining number of systicks
-                while (currentTick < next_period_start)
+                // Unless catching up, we search for its next period...
+                if (state.overrun_policy != PERIODIC_OVERRUN_CATCH_UP)
                 {
-                    currentTick = generic_timer_read_counter();
+                    while (currentTick > next_period_start)
+                    {
+                        next_period_start += tickPeriod;
+                        state.statistics.skipped_release_number++;
+                    }
                 }
+
+                state.statistics.degraded = state.overrun_policy == PERIODIC_OVERRUN_DEGRADE;
+            }
+            else
+            {
+                // On time again
+                state.statistics.degraded = 0;
             }
 
-            // Update last period start cycle
-            last_period_start[task_id] = next_period_start;
+            // If a new cycle didn't start yet, then block until the release queue releases the task
+            release->release_time = next_period_start;
+            if (currentTick < next_period_start)
+            {
+                release_queue_wait(release);
+                record_wakeup(&state);
+            }
         }
         else
         {
-            last_period_start[task_id] = generic_timer_read_counter();
+            release->release_time = generic_timer_read_counter();
         }
+
+        // Update last period start cycle
+        set_last_period_start(task_id, release->release_time);
+    }
+}
+
+/* Fills the private arguments of a periodic task and takes its id, returns pdFAIL if the registry can not grow */
+BaseType_t init_periodic_arguments(struct prv_periodic_arguments *periodic_arguments_ptr, TaskFunction_t pxTaskCode, const struct periodic_arguments *periodic_arguments, uint8_t allocated)
+{
+    uint32_t task_id = periodic_registry_allocate();
+    if (task_id == PERIODIC_REGISTRY_NO_ENTRY)
+    {
+        return pdFAIL;
+    }
+
+    periodic_arguments_ptr->pxTaskCode = pxTaskCode;
+    periodic_arguments_ptr->systick_period = generic_timer_ticks_to_systick(periodic_arguments->tickPeriod);
+    periodic_arguments_ptr->systick_offset = generic_timer_ticks_to_systick(periodic_arguments->tickOffset);
+    periodic_arguments_ptr->task_id = task_id;
+    periodic_arguments_ptr->overrun_policy = periodic_arguments->overrunPolicy;
+    periodic_arguments_ptr->allocated = allocated;
+    periodic_arguments_ptr->pvParameters = periodic_arguments->pvParameters;
+
+    // Releases are on the physical timer
+    release_queue_init();
+    return pdPASS;
+}
+
+/* Records the handle of the created task in its entry, or frees the entry if the creation failed */
+void register_periodic_task(uint32_t task_id, TaskHandle_t task)
+{
+    taskENTER_CRITICAL();
+    if (task == NULL)
+    {
+        periodic_registry_release(task_id);
+    }
+    else
+    {
+        periodic_registry[task_id].task = task;
     }
+    taskEXIT_CRITICAL();
 }
 
 BaseType_t xTaskPeriodicCreate(TaskFunction_t pxTaskCode,
@@ -116,25 +347,212 @@ BaseType_t xTaskPeriodicCreate(TaskFunction_t pxTaskCode,
 {
     // Create and fill struct
     struct prv_periodic_arguments *periodic_arguments_ptr = (struct prv_periodic_arguments *)pvPortMalloc(sizeof(struct prv_periodic_arguments));
+    if (periodic_arguments_ptr == NULL)
+    {
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    if (init_periodic_arguments(periodic_arguments_ptr, pxTaskCode, &periodic_arguments, 1) != pdPASS)
+    {
+        vPortFree(periodic_arguments_ptr);
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    uint32_t task_id = periodic_arguments_ptr->task_id;
 
-    periodic_arguments_ptr->pxTaskCode = pxTaskCode;
-    periodic_arguments_ptr->systick_period = pdTICKS_TO_SYSTICK(generic_timer_get_freq(), periodic_arguments.tickPeriod);
-    periodic_arguments_ptr->task_id = periodic_task_number++;
-    periodic_arguments_ptr->pvParameters = periodic_arguments.pvParameters;
-
+    // The task must not run (and be deleted) before its handle is in the registry
+    TaskHandle_t task = NULL;
+    vTaskSuspendAll();
     BaseType_t creationAck = xTaskCreate(vPeriodicTask,
                                          pcName,
                                          uxStackDepth,
                                          (void *)periodic_arguments_ptr,
                                          uxPriority,
-                                         pxCreatedTask);
+                                         &task);
+    register_periodic_task(task_id, creationAck == pdPASS ? task : NULL);
+    xTaskResumeAll();
+
+    // The task will never free it
+    if (creationAck != pdPASS)
+    {
+        vPortFree(periodic_arguments_ptr);
+    }
+
+    if (pxCreatedTask != NULL)
+    {
+        *pxCreatedTask = task;
+    }
 
     return creationAck;
 }
 
-TickType_t get_last_period_start(uint8_t task_id)
+TaskHandle_t xTaskPeriodicCreateStatic(TaskFunction_t pxTaskCode,
+                                       const char *const pcName,
+                                       const uint32_t ulStackDepth,
+                                       const struct periodic_arguments periodic_arguments,
+                                       UBaseType_t uxPriority,
+                                       StackType_t *const puxStackBuffer,
+                                       struct periodic_task_buffer *const pxTaskBuffer)
+{
+    if (pxTaskBuffer == NULL)
+    {
+        return NULL;
+    }
+    if (init_periodic_arguments(&pxTaskBuffer->arguments, pxTaskCode, &periodic_arguments, 0) != pdPASS)
+    {
+        return NULL;
+    }
+    uint32_t task_id = pxTaskBuffer->arguments.task_id;
+
+    // Same as above, the handle is registered before the task can run
+    vTaskSuspendAll();
+    TaskHandle_t task = xTaskCreateStatic(vPeriodicTask,
+                                          pcName,
+                                          ulStackDepth,
+                                          (void *)&pxTaskBuffer->arguments,
+                                          uxPriority,
+                                          puxStackBuffer,
+                                          &pxTaskBuffer->task);
+    register_periodic_task(task_id, task);
+    xTaskResumeAll();
+
+    return task;
+}
+
+void vPeriodicTaskDeleted(void *task)
+{
+    // Its release can not stay in the queue
+    release_queue_remove_task(task);
+
+    taskENTER_CRITICAL();
+
+    // The id is in the state if the task ran, else search the handle
+    uint32_t task_id = PERIODIC_REGISTRY_NO_ENTRY;
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer((TaskHandle_t)task, PERIODIC_RELEASE_TLS_INDEX);
+    if (state != NULL)
+    {
+        task_id = state->task_id;
+    }
+    else
+    {
+        for (uint32_t index = 0; index < periodic_registry_used; index++)
+        {
+            if (periodic_registry[index].used && periodic_registry[index].task == task)
+            {
+                task_id = index;
+                break;
+            }
+        }
+    }
+
+    // Not a periodic task otherwise
+    if (task_id != PERIODIC_REGISTRY_NO_ENTRY)
+    {
+        periodic_registry_release(task_id);
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+TaskHandle_t xTaskPeriodicGetHandle(uint32_t task_id)
+{
+    TaskHandle_t task = NULL;
+
+    taskENTER_CRITICAL();
+    if (task_id < periodic_registry_used && periodic_registry[task_id].used)
+    {
+        task = periodic_registry[task_id].task;
+    }
+    taskEXIT_CRITICAL();
+
+    return task;
+}
+
+TickType_t get_last_period_start(uint32_t task_id)
+{
+    uint64_t period_start = 0;
+
+    taskENTER_CRITICAL();
+    if (task_id < periodic_registry_used && periodic_registry[task_id].used)
+    {
+        period_start = periodic_registry[task_id].last_period_start;
+    }
+    taskEXIT_CRITICAL();
+
+    return period_start;
+}
+
+uint64_t get_release_time(void)
+{
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer(NULL, PERIODIC_RELEASE_TLS_INDEX);
+    if (state == NULL)
+    {
+        return 0;
+    }
+
+    return state->release.release_time;
+}
+
+BaseType_t xTaskPeriodicGetStatistics(TaskHandle_t xTask, struct periodic_statistics *pxStatistics)
+{
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer(xTask, PERIODIC_RELEASE_TLS_INDEX);
+    if (state == NULL)
+    {
+        return pdFAIL;
+    }
+
+    *pxStatistics = state->statistics;
+    return pdPASS;
+}
+
+BaseType_t xTaskPeriodicIsDegraded(void)
+{
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer(NULL, PERIODIC_RELEASE_TLS_INDEX);
+    if (state == NULL || !state->statistics.degraded)
+    {
+        return pdFALSE;
+    }
+
+    return pdTRUE;
+}
+
+void vTaskPeriodicPrintStatistics(TaskHandle_t xTask)
+{
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer(xTask, PERIODIC_RELEASE_TLS_INDEX);
+    if (state == NULL)
+    {
+        return;
+    }
+
+    printf("jobs_task%u = %llu\n", state->task_id, state->statistics.job_number);
+    printf("overruns_task%u = %llu\n", state->task_id, state->statistics.overrun_number);
+    printf("skipped_releases_task%u = %llu\n", state->task_id, state->statistics.skipped_release_number);
+    printf("max_lateness_task%u_ns = %llu # ns\n", state->task_id, generic_timer_systick_to_ns(state->statistics.max_lateness));
+
+#ifdef MEASURE_RELEASE_LATENCY
+    if (state->latencies != NULL)
+    {
+        char histogram_name[40];
+        snprintf(histogram_name, sizeof(histogram_name), "_wakeup_latency_task%u_ns", state->task_id);
+        histogram_print_converted_percentiles(&state->latencies->wakeup_latencies, histogram_name, "ns", generic_timer_systick_to_ns);
+        snprintf(histogram_name, sizeof(histogram_name), "_start_latency_task%u_ns", state->task_id);
+        histogram_print_converted_percentiles(&state->latencies->start_latencies, histogram_name, "ns", generic_timer_systick_to_ns);
+    }
+#endif
+}
+
+void vTaskPeriodicSetJobStart(uint64_t job_start)
+{
+#ifdef MEASURE_RELEASE_LATENCY
+    struct periodic_task_state *state = (struct periodic_task_state *)pvTaskGetThreadLocalStoragePointer(NULL, PERIODIC_RELEASE_TLS_INDEX);
+    if (state != NULL)
+    {
+        state->job_start = job_start;
+    }
+#endif
+}
+
+void vPeriodicSetStartAlignment(TickType_t tickAlignment)
 {
-    return last_period_start[task_id];
+    start_alignment = generic_timer_ticks_to_systick(tickAlignment);
 }
 
 void vTaskPeriodicDelete()
@@ -144,6 +562,5 @@ void vTaskPeriodicDelete()
 
 void vInitPeriodic(void)
 {
-    // Create the array of last period times
-    last_period_start = (uint64_t *)pvPortMalloc(sizeof(uint64_t) * periodic_task_number);
+    // The registry starts static and grows when tasks are created, nothing to do
 }
\ No newline at end of file
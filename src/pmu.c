@@ -0,0 +1,48 @@
+#include <pmu.h>
+
+// PMCR_EL0 enable bit
+#define PMCR_E (1 << 0)
+
+void pmu_select_counter(uint64_t counter)
+{
+    asm volatile("msr pmselr_el0, %0" ::"r"(counter));
+    asm volatile("isb");
+}
+
+void pmu_enable_counter(uint64_t counter, uint64_t event)
+{
+    uint64_t pmcr;
+
+    // Enable the PMU
+    asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    asm volatile("msr pmcr_el0, %0" ::"r"(pmcr | PMCR_E));
+
+    // Set the event, reset and enable the counter
+    pmu_select_counter(counter);
+    asm volatile("msr pmxevtyper_el0, %0" ::"r"(event));
+    asm volatile("msr pmxevcntr_el0, %0" ::"r"(0UL));
+    asm volatile("msr pmcntenset_el0, %0" ::"r"(1UL << counter));
+    asm volatile("isb");
+}
+
+void pmu_disable_counter(uint64_t counter)
+{
+    asm volatile("msr pmcntenclr_el0, %0" ::"r"(1UL << counter));
+    asm volatile("isb");
+}
+
+void pmu_reset_counter(uint64_t counter)
+{
+    pmu_select_counter(counter);
+    asm volatile("msr pmxevcntr_el0, %0" ::"r"(0UL));
+}
+
+uint64_t pmu_read_counter(uint64_t counter)
+{
+    uint64_t value;
+
+    pmu_select_counter(counter);
+    asm volatile("mrs %0, pmxevcntr_el0" : "=r"(value));
+
+    return value;
+}
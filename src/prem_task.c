@@ -4,28 +4,33 @@
 #include <periodic_task.h>
 #include <state_machine.h>
 #include <prefetch.h>
+#include <cache.h>
+#include <residency.h>
+#include <color.h>
 #include <hypervisor.h>
 #include <ipi.h>
 #include <irq.h>
 #include <generic_timer.h>
+#include <histogram.h>
 #include <stdio.h>
 
-/* PREM task parameters that are really used in the task */
-struct prv_premtask_parameters
-{
-    TaskFunction_t pxTaskCode;
-    uint64_t data_size;
-    void *data;
-    uint8_t task_id;
-    uint64_t wcet;
-    void *pvParameters;
-};
-
-volatile union memory_request_answer memory_access = {.raw = 0};
-volatile uint8_t hypercalled = 0;
-volatile uint8_t suspend_prefetch = 0;
-volatile uint64_t end_low_prio = 0;
-volatile uint8_t revoked = 0; // Here to get hypercall response and ensure revoke is called
+/* Maximum number of memory requests that can be pending on this core (one per priority) */
+#define MAX_PENDING_MEMORY_REQUESTS configMAX_PRIORITIES
+
+/*
+ * Memory phase strategy: prfm hints by default (faster, but lines can still be in
+ * flight when access is revoked) or loads of each line with MEMORY_PHASE_TOUCH (all
+ * lines are in the cache before access is revoked)
+ */
+#ifdef MEMORY_PHASE_TOUCH
+#define MEMORY_PHASE_LOAD touch_data_prem
+#else
+#define MEMORY_PHASE_LOAD prefetch_data_prem
+#endif
+
+// Stack of the memory requests of this core, the top one is the running PREM task
+struct prem_control_block *memory_requests[MAX_PENDING_MEMORY_REQUESTS];
+volatile uint8_t memory_request_number = 0;
 
 uint64_t cpu_priority = 0;
 
@@ -35,20 +40,77 @@ uint8_t ask_display_results = 0;
 uint8_t ask_change_prefetch_size = 0;
 uint64_t new_prefetch_size = 0;
 
-#ifdef MEASURE_RESPONSE_TIME
-uint8_t measure_response_time = 1;
-#else
-uint8_t measure_response_time = 0;
-#endif
-uint64_t *response_max;
-uint64_t *response_min;
-uint64_t *response_sum;
-uint64_t *response_number;
+// Number of live PREM tasks of the core using each L2 color, to warn about overlapping working sets
+uint32_t prem_color_users[COLOR_MAX_NUMBER] = {0};
+
+/* Adds the colors of a PREM task, returns the colors already used by another task */
+uint64_t take_prem_colors(uint64_t color_mask)
+{
+    uint64_t shared_mask = 0;
+    for (uint64_t color = 0; color < COLOR_MAX_NUMBER; color++)
+    {
+        if (color_mask & (1ULL << color))
+        {
+            if (prem_color_users[color]++ != 0)
+            {
+                shared_mask |= 1ULL << color;
+            }
+        }
+    }
+    return shared_mask;
+}
 
-void suspend_task()
+/* Removes the colors of a deleted PREM task */
+void release_prem_colors(uint64_t color_mask)
+{
+    for (uint64_t color = 0; color < COLOR_MAX_NUMBER; color++)
+    {
+        if ((color_mask & (1ULL << color)) && prem_color_users[color] != 0)
+        {
+            prem_color_users[color]--;
+        }
+    }
+}
+
+/* Returns the control block of the active memory request, or NULL if there is none */
+struct prem_control_block *get_active_request(void)
+{
+    if (memory_request_number == 0)
+    {
+        return NULL;
+    }
+
+    return memory_requests[memory_request_number - 1];
+}
+
+/*
+ * Asks memory to the hypervisor for the given control block and stores the
+ * answer in it. If there is a time to wait, the end of the low priority is set.
+ */
+void request_memory(struct prem_control_block *control_block)
+{
+    control_block->memory_access.raw = request_memory_access(cpu_priority, control_block->wcet);
+
+    // Whether the answer is yes or no, if ttw is not 0 then set a number a cycles to wait before leaving low prio
+    // The physical timer interrupts when it is over (cf. end_low_prio_handler)
+    if (control_block->memory_access.ttw != 0)
+    {
+        control_block->end_low_prio = generic_timer_read_counter() + control_block->memory_access.ttw;
+        generic_timer_set_deadline(GENERIC_TIMER_DEADLINE_PREM, control_block->end_low_prio);
+    }
+    else
+    {
+        control_block->end_low_prio = 0;
+        generic_timer_cancel_deadline(GENERIC_TIMER_DEADLINE_PREM);
+    }
+
+    control_block->suspend_prefetch = !control_block->memory_access.ack;
+}
+
+void suspend_task(struct prem_control_block *control_block)
 {
     // Wait for interrupt so we don't look at the memory for nothing
-    while (suspend_prefetch == 1)
+    while (control_block->suspend_prefetch == 1)
     {
         __asm__ volatile("wfi");
 
@@ -61,7 +123,14 @@ void suspend_task()
 /* Value that indicates if need to suspend prefetch (0 is no) */
 void ipi_pause_handler(unsigned int id)
 {
-    suspend_prefetch = 1;
+    // Only the active request can be paused, the others are not prefetching
+    struct prem_control_block *control_block = get_active_request();
+    if (control_block == NULL)
+    {
+        return;
+    }
+
+    control_block->suspend_prefetch = 1;
     // printf("PAUSE CORE %d\n", cpu_priority);
     enum states current_state = get_current_state();
     if (current_state == MEMORY_PHASE)
@@ -73,7 +142,13 @@ void ipi_pause_handler(unsigned int id)
 
 void ipi_resume_handler(unsigned int id)
 {
-    suspend_prefetch = 0;
+    struct prem_control_block *control_block = get_active_request();
+    if (control_block == NULL)
+    {
+        return;
+    }
+
+    control_block->suspend_prefetch = 0;
     // printf("RESUME CORE %d\n", cpu_priority);
     enum states current_state = get_current_state();
     if (current_state == SUSPENDED)
@@ -85,31 +160,39 @@ void ipi_resume_handler(unsigned int id)
 #endif
 
 /*
- * At each tick, will compute remaining time and if needs to update prio to the hypervisor.
+ * Physical timer deadline, armed at the end of the low priority of the active request.
+ * Updates the priority to the hypervisor when it is over.
  *
  * MUST verify that not in computation phase!
  */
-void vApplicationTickHook(void)
+void end_low_prio_handler(void)
 {
-    if (end_low_prio != 0)
+    // Only the active request is waiting for the end of its low priority
+    struct prem_control_block *control_block = get_active_request();
+    if (control_block != NULL && control_block->end_low_prio != 0)
     {
         enum states current_state = get_current_state();
 
         // If already in computation phase, too late stop looking
         if (current_state == COMPUTATION_PHASE)
         {
-            end_low_prio = 0;
+            control_block->end_low_prio = 0;
         }
         else
         {
             uint64_t current_time = generic_timer_read_counter();
-            if (current_time >= end_low_prio)
+            if (current_time >= control_block->end_low_prio)
             {
-                end_low_prio = 0;
+                control_block->end_low_prio = 0;
 
                 // Time to wait over, just yes or no!
-                union memory_request_answer update = {.raw = update_memory_access(cpu_priority)};
-                suspend_prefetch = ~update.ack;
+                control_block->memory_access.raw = update_memory_access(cpu_priority);
+                control_block->suspend_prefetch = !control_block->memory_access.ack;
+            }
+            else
+            {
+                // Not for this request (it was armed for another one), wait again
+                generic_timer_set_deadline(GENERIC_TIMER_DEADLINE_PREM, control_block->end_low_prio);
             }
         }
     }
@@ -125,106 +208,168 @@ void vTaskPREMDelay(TickType_t waitingTicks)
     }
 }
 
-void display_results(uint8_t task_id)
+/* Cache maintenance to do after the job on a region */
+uint8_t get_region_maintenance(const struct premtask_region *premtask_region)
 {
-    hypercall(HC_DISPLAY_RESULTS, task_id, response_max[task_id], response_sum[task_id]);
-    hypercall(HC_DISPLAY_RESULTS, task_id, response_min[task_id], 0);
+    if (premtask_region->access == PREM_ACCESS_READ_ONLY)
+    {
+        return premtask_region->keep_warm ? CACHE_NO_MAINTENANCE : CACHE_INVALIDATE;
+    }
+
+    return premtask_region->keep_warm ? CACHE_CLEAN : CACHE_CLEAN_INVALIDATE;
+}
+
+void display_results(struct prv_premtask_parameters *prv_premtask_parameters)
+{
+    // Nothing to display if not measured
+#ifdef MEASURE_RESPONSE_TIME
+    uint8_t task_id = prv_premtask_parameters->task_id;
+    struct histogram *response_histogram = &prv_premtask_parameters->response_histogram;
+    // Responses are recorded in systicks, converted to ns only here
+    uint64_t response_min = response_histogram->total == 0 ? UINT64_MAX : generic_timer_systick_to_ns(response_histogram->min);
+    hypercall(HC_DISPLAY_RESULTS, task_id, generic_timer_systick_to_ns(response_histogram->max), generic_timer_systick_to_ns(response_histogram->sum));
+    hypercall(HC_DISPLAY_RESULTS, task_id, response_min, 0);
+
+    // Tail latencies from the histogram
+    char histogram_name[32];
+    snprintf(histogram_name, sizeof(histogram_name), "_response_task%u_ns", task_id);
+    histogram_print_converted_percentiles(response_histogram, histogram_name, "ns", generic_timer_systick_to_ns);
+#ifdef DISPLAY_RESPONSE_HISTOGRAM
+    histogram_print_converted_buckets(response_histogram, histogram_name, generic_timer_systick_to_ns);
+#endif
 
     // Reset values
-    response_max[task_id] = 0;
-    response_min[task_id] = UINT64_MAX;
-    response_sum[task_id] = 0;
-    response_number[task_id] = 0;
+    histogram_reset(response_histogram);
+    prv_premtask_parameters->response_number = 0;
+#endif
 }
 
 void vPREMTask(void *pvParameters)
 {
     // pvParameters are the private PREM struct
     struct prv_premtask_parameters *prv_premtask_parameters = (struct prv_premtask_parameters *)pvParameters;
+    struct prem_control_block *control_block = &prv_premtask_parameters->control_block;
 
     // Stop scheduler to be sure to not be preempted
     vTaskSuspendAll();
+    control_block->release_time = get_release_time();
 
-    // If hypercall counter is 0, then we request memory
-    if (hypercalled++ == 0)
-    {
-        memory_access.raw = request_memory_access(cpu_priority, prv_premtask_parameters->wcet);
-    }
+    // Push the request on top of the core's requests and ask for memory with this task's WCET.
+    // If a lower priority task was waiting for memory, its request stays below and is done again later
+    configASSERT(memory_request_number < MAX_PENDING_MEMORY_REQUESTS);
+    memory_requests[memory_request_number++] = control_block;
+    request_memory(control_block);
 
-    // Whether the answer is yes or no, if ttw is not 0 then set a number a cycles to wait before leaving low prio
-    if (memory_access.ttw != 0)
+#ifdef PREM_RESIDENCY_TRACKING
+    // Preempting another PREM task, its prefetched data can be evicted
+    if (memory_request_number > 1)
     {
-        // Compute cycles to wait
-        end_low_prio = generic_timer_read_counter() + memory_access.ttw;
+        residency_invalidate_all();
     }
+#endif
 
     // If answer is no, then set suspended
-    if (memory_access.ack == 0)
+    if (control_block->memory_access.ack == 0)
     {
         change_state(SUSPENDED);
-        suspend_prefetch = 1;
         // Re-enable scheduler so higher prio tasks can take over
         // xTaskResumeAll();
-        // suspend_task();
+        // suspend_task(control_block);
 
         // // Once got out, stop scheduler!
         // vTaskSuspendAll();
     }
 
-    // Begin memory phase
+    // Begin memory phase, all regions are prefetched with the same memory access
     change_state(MEMORY_PHASE);
-    prefetch_data_prem((uint64_t)prv_premtask_parameters->data, prv_premtask_parameters->data_size, &suspend_prefetch);
+    control_block->memory_phase_start = generic_timer_read_counter();
+#ifdef PREM_RESIDENCY_TRACKING
+    // What is missing for the whole job must fit next to what is skipped, or the loads could evict it
+    uint64_t load_ways = 0;
+    uint64_t load_number = 0;
+    for (uint64_t region = 0; region < prv_premtask_parameters->region_number; region++)
+    {
+        uint64_t load_address;
+        uint64_t load_size = residency_get_missing((uint64_t)prv_premtask_parameters->regions[region].data, prv_premtask_parameters->regions[region].data_size, &load_address);
+        load_ways += residency_get_ways(load_size);
+        load_number += load_size != 0;
+    }
+    if (!residency_can_load(load_ways, load_number))
+    {
+        residency_invalidate_all();
+    }
+
+    // Only load what is not already in the cache
+    uint64_t generation = residency_get_generation();
+    uint8_t skipped = 0;
+    for (uint64_t region = 0; region < prv_premtask_parameters->region_number; region++)
+    {
+        uint64_t load_address;
+        uint64_t load_size = residency_get_missing((uint64_t)prv_premtask_parameters->regions[region].data, prv_premtask_parameters->regions[region].data_size, &load_address);
+        skipped |= load_size != prv_premtask_parameters->regions[region].data_size;
+        MEMORY_PHASE_LOAD(load_address, load_size, &control_block->suspend_prefetch);
+        residency_mark_loaded(load_address, load_size, generation);
+    }
+
+    // Something was forgotten while loading (preemption...), skipped parts may be gone: load everything
+    if (skipped && residency_get_generation() != generation)
+    {
+        for (uint64_t region = 0; region < prv_premtask_parameters->region_number; region++)
+        {
+            MEMORY_PHASE_LOAD((uint64_t)prv_premtask_parameters->regions[region].data, prv_premtask_parameters->regions[region].data_size, &control_block->suspend_prefetch);
+        }
+    }
+#else
+    for (uint64_t region = 0; region < prv_premtask_parameters->region_number; region++)
+    {
+        MEMORY_PHASE_LOAD((uint64_t)prv_premtask_parameters->regions[region].data, prv_premtask_parameters->regions[region].data_size, &control_block->suspend_prefetch);
+    }
+#endif
 
     // Revoke access and compute
     change_state(COMPUTATION_PHASE);
-    end_low_prio = 0;
-    revoked = revoke_memory_access();
+#ifdef PREM_SUPPRESS_TICK
+    // No tick until the end of the job, missed ticks are caught up after
+    FreeRTOS_MaskTickInterrupt();
+#endif
+    control_block->computation_phase_start = generic_timer_read_counter();
+    control_block->end_low_prio = 0;
+    generic_timer_cancel_deadline(GENERIC_TIMER_DEADLINE_PREM);
+    // Volatile to get the hypercall response and ensure revoke is called
+    volatile uint8_t revoked = revoke_memory_access();
     // If successfully revoked, then execute code, else clear cache
     if (revoked == 0)
     {
         // printf("Revoked!\n");
+        vTaskPeriodicSetJobStart(control_block->computation_phase_start);
         prv_premtask_parameters->pxTaskCode(prv_premtask_parameters->pvParameters);
     }
 
-    // Clear used cache
-    clear_L2_cache((uint64_t)prv_premtask_parameters->data, prv_premtask_parameters->data_size);
-
-    // Decrease hypercall counter and if it is more than 1, we request again (for preempted task)
-    if (--hypercalled != 0)
+    // Clear used cache, depending on how each region was accessed
+    for (uint64_t region = 0; region < prv_premtask_parameters->region_number; region++)
     {
-        memory_access.raw = request_memory_access(cpu_priority, prv_premtask_parameters->wcet);
-
-        // If there is still delay, set cycles once again
-        if (memory_access.ttw != 0)
-        {
-            end_low_prio = generic_timer_read_counter() + memory_access.ttw;
-        }
+        const struct premtask_region *premtask_region = &prv_premtask_parameters->regions[region];
+        cache_maintain_range((uint64_t)premtask_region->data, premtask_region->data_size, get_region_maintenance(premtask_region));
     }
-    else
+
+    // Pop the request and if a preempted task is still waiting, request again with its own WCET
+    control_block->memory_access.raw = 0;
+    memory_requests[--memory_request_number] = NULL;
+    struct prem_control_block *preempted_request = get_active_request();
+    if (preempted_request != NULL)
     {
-        memory_access.raw = 0;
+        request_memory(preempted_request);
     }
 
     // Measure response time (Write from hypervisor task priority and response time)
     // Always skip the first one
-    if (measure_response_time && response_number[prv_premtask_parameters->task_id]++ > 0)
+    control_block->end_time = generic_timer_read_counter();
+#ifdef MEASURE_RESPONSE_TIME
+    if (prv_premtask_parameters->response_number++ > 0)
     {
-        uint64_t end_time = generic_timer_read_counter();
-        uint64_t release_time = get_last_period_start(prv_premtask_parameters->task_id);
-        uint64_t response_time = pdSYSTICK_TO_NS(generic_timer_get_freq(), end_time - release_time);
-
-        if (response_max[prv_premtask_parameters->task_id] < response_time)
-        {
-            response_max[prv_premtask_parameters->task_id] = response_time;
-        }
-
-        if (response_min[prv_premtask_parameters->task_id] > response_time)
-        {
-            response_min[prv_premtask_parameters->task_id] = response_time;
-        }
-
-        response_sum[prv_premtask_parameters->task_id] += response_time;
+        histogram_record(&prv_premtask_parameters->response_histogram, control_block->end_time - control_block->release_time);
     }
+#endif
 
     // If wants to change the prefetch size, then change it here
     // If the user is schizophrenic and also asks to kill the task,
@@ -232,7 +377,7 @@ void vPREMTask(void *pvParameters)
     if (ask_change_prefetch_size == 1)
     {
         ask_change_prefetch_size = 0;
-        prv_premtask_parameters->data_size = new_prefetch_size;
+        prv_premtask_parameters->regions[0].data_size = new_prefetch_size;
     }
 
     // If the user wants to delete the task, then do it
@@ -242,20 +387,96 @@ void vPREMTask(void *pvParameters)
         kill_prem_task = 0;
         vTaskPeriodicDelete();
 
-        display_results(prv_premtask_parameters->task_id);
+        display_results(prv_premtask_parameters);
+        release_prem_colors(prv_premtask_parameters->color_mask);
 
-        // Free task parameters
-        vPortFree(prv_premtask_parameters);
+        // Free task parameters (if not statically allocated)
+        if (prv_premtask_parameters->allocated)
+        {
+            vPortFree(prv_premtask_parameters);
+        }
     }
     else if (ask_display_results == 1)
     {
         ask_display_results = 0;
-        display_results(prv_premtask_parameters->task_id);
+        display_results(prv_premtask_parameters);
+        vTaskPeriodicPrintStatistics(NULL);
     }
 
     // Wait (resume scheduler)
     change_state(WAITING);
+#ifdef PREM_SUPPRESS_TICK
+    uint64_t missed_ticks = FreeRTOS_UnmaskTickInterrupt();
+    xTaskResumeAll();
+    xTaskCatchUpTicks(missed_ticks);
+#else
     xTaskResumeAll();
+#endif
+}
+
+/*
+ * Fills the private parameters of a PREM task, the regions are copied in
+ * [regions]. Returns the periodic arguments of the task.
+ */
+struct periodic_arguments init_premtask_parameters(struct prv_premtask_parameters *premtask_parameters_ptr,
+                                                   struct premtask_region *regions,
+                                                   TaskFunction_t pxTaskCode,
+                                                   const char *const pcName,
+                                                   const struct premtask_parameters *premtask_parameters,
+                                                   uint8_t allocated)
+{
+    // If no region list, then data and data_size are the only region
+    uint64_t region_number = premtask_parameters->region_number;
+    if (region_number == 0)
+    {
+        region_number = 1;
+    }
+
+    premtask_parameters_ptr->pxTaskCode = pxTaskCode;
+    premtask_parameters_ptr->allocated = allocated;
+    premtask_parameters_ptr->region_number = region_number;
+    premtask_parameters_ptr->regions = regions;
+    if (premtask_parameters->region_number == 0)
+    {
+        regions[0].data = premtask_parameters->data;
+        regions[0].data_size = premtask_parameters->data_size;
+        regions[0].access = premtask_parameters->data_access;
+        regions[0].keep_warm = premtask_parameters->data_keep_warm;
+    }
+    else
+    {
+        for (uint64_t region = 0; region < region_number; region++)
+        {
+            regions[region] = premtask_parameters->regions[region];
+        }
+    }
+    premtask_parameters_ptr->task_id = task_id++;
+
+    // Warn if the working set shares L2 colors with another PREM task of the core (they can evict each other)
+    uint64_t color_mask = 0;
+    for (uint64_t region = 0; region < region_number; region++)
+    {
+        color_mask |= color_get_mask(regions[region].data, regions[region].data_size);
+    }
+    premtask_parameters_ptr->color_mask = color_mask;
+    uint64_t shared_mask = take_prem_colors(color_mask);
+    if (shared_mask != 0)
+    {
+        printf("# Warning: PREM task %s shares L2 colors 0x%llx with other PREM tasks\n", pcName, shared_mask);
+    }
+    premtask_parameters_ptr->control_block.memory_access.raw = 0;
+    premtask_parameters_ptr->control_block.end_low_prio = 0;
+    premtask_parameters_ptr->control_block.suspend_prefetch = 0;
+    premtask_parameters_ptr->control_block.wcet = generic_timer_ns_to_systick(premtask_parameters->wcet);
+    premtask_parameters_ptr->pvParameters = premtask_parameters->pvParameters;
+#ifdef MEASURE_RESPONSE_TIME
+    histogram_reset(&premtask_parameters_ptr->response_histogram);
+    premtask_parameters_ptr->response_number = 0;
+#endif
+
+    // Periodic task with custom arguments
+    struct periodic_arguments periodic_arguments = {.tickPeriod = premtask_parameters->tickPeriod, .pvParameters = (void *)premtask_parameters_ptr, .tickOffset = premtask_parameters->tickOffset, .overrunPolicy = premtask_parameters->overrunPolicy};
+    return periodic_arguments;
 }
 
 BaseType_t xTaskPREMCreate(TaskFunction_t pxTaskCode,
@@ -265,25 +486,66 @@ BaseType_t xTaskPREMCreate(TaskFunction_t pxTaskCode,
                            UBaseType_t uxPriority,
                            TaskHandle_t *const pxCreatedTask)
 {
-    // Create and fill struct
-    // This structure is freed only when task gets deleted!
-    struct prv_premtask_parameters *premtask_parameters_ptr = (struct prv_premtask_parameters *)pvPortMalloc(sizeof(struct prv_premtask_parameters));
+    uint64_t region_number = premtask_parameters.region_number == 0 ? 1 : premtask_parameters.region_number;
 
-    premtask_parameters_ptr->pxTaskCode = pxTaskCode;
-    premtask_parameters_ptr->data_size = premtask_parameters.data_size;
-    premtask_parameters_ptr->data = premtask_parameters.data;
-    premtask_parameters_ptr->task_id = task_id++;
-    premtask_parameters_ptr->wcet = pdNS_TO_SYSTICK(generic_timer_get_freq(), premtask_parameters.wcet);
-    premtask_parameters_ptr->pvParameters = premtask_parameters.pvParameters;
+    // Create and fill struct (with its regions)
+    // This structure is freed only when task gets deleted!
+    struct prv_premtask_parameters *premtask_parameters_ptr = (struct prv_premtask_parameters *)pvPortMalloc(sizeof(struct prv_premtask_parameters) + sizeof(struct premtask_region) * region_number);
+    if (premtask_parameters_ptr == NULL)
+    {
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    struct premtask_region *regions = (struct premtask_region *)(premtask_parameters_ptr + 1);
+    struct periodic_arguments periodic_arguments = init_premtask_parameters(premtask_parameters_ptr, regions, pxTaskCode, pcName, &premtask_parameters, 1);
 
     // Create a periodic task with custom arguments
-    struct periodic_arguments periodic_arguments = {.tickPeriod = premtask_parameters.tickPeriod, .pvParameters = (void *)premtask_parameters_ptr};
-    xTaskPeriodicCreate(vPREMTask,
-                        pcName,
-                        uxStackDepth,
-                        periodic_arguments,
-                        uxPriority,
-                        pxCreatedTask);
+    BaseType_t creationAck = xTaskPeriodicCreate(vPREMTask,
+                                                 pcName,
+                                                 uxStackDepth,
+                                                 periodic_arguments,
+                                                 uxPriority,
+                                                 pxCreatedTask);
+
+    // The task will never free it
+    if (creationAck != pdPASS)
+    {
+        release_prem_colors(premtask_parameters_ptr->color_mask);
+        vPortFree(premtask_parameters_ptr);
+    }
+
+    return creationAck;
+}
+
+TaskHandle_t xTaskPREMCreateStatic(TaskFunction_t pxTaskCode,
+                                   const char *const pcName,
+                                   const uint32_t ulStackDepth,
+                                   const struct premtask_parameters premtask_parameters,
+                                   UBaseType_t uxPriority,
+                                   StackType_t *const puxStackBuffer,
+                                   struct premtask_buffer *const pxTaskBuffer)
+{
+    if (pxTaskBuffer == NULL)
+    {
+        return NULL;
+    }
+    configASSERT(premtask_parameters.region_number <= PREM_STATIC_MAX_REGIONS);
+
+    struct periodic_arguments periodic_arguments = init_premtask_parameters(&pxTaskBuffer->parameters, pxTaskBuffer->regions, pxTaskCode, pcName, &premtask_parameters, 0);
+    TaskHandle_t task = xTaskPeriodicCreateStatic(vPREMTask,
+                                                  pcName,
+                                                  ulStackDepth,
+                                                  periodic_arguments,
+                                                  uxPriority,
+                                                  puxStackBuffer,
+                                                  &pxTaskBuffer->periodic);
+
+    // The task will never give its colors back
+    if (task == NULL)
+    {
+        release_prem_colors(pxTaskBuffer->parameters.color_mask);
+    }
+
+    return task;
 }
 
 void vTaskPREMDelete()
@@ -307,18 +569,16 @@ void vInitPREM()
     // Init periodic tasks
     vInitPeriodic();
 
-#ifdef MEASURE_RESPONSE_TIME
-    // Malloc the measure pointers
-    response_sum = pvPortMalloc(sizeof(uint64_t) * task_id);
-    response_min = pvPortMalloc(sizeof(uint64_t) * task_id);
-    response_max = pvPortMalloc(sizeof(uint64_t) * task_id);
-    for (int i = 0; i < task_id; i++)
-    {
-        response_max[i] = 0;
-        response_min[i] = UINT64_MAX;
-        response_sum[i] = 0;
-        response_number[i] = 0;
-    }
+    // End of low priority on the physical timer (the tick uses the virtual one)
+    generic_timer_cancel_deadline(GENERIC_TIMER_DEADLINE_PREM);
+    generic_timer_set_deadline_handler(GENERIC_TIMER_DEADLINE_PREM, end_low_prio_handler);
+
+#ifdef PREM_CACHE_FIRST_COLOR
+    // Big regions are cleaned by set/way in the colors of the VM
+    color_set_cache_partition(PREM_CACHE_FIRST_COLOR, PREM_CACHE_LAST_COLOR);
+#ifdef PREM_CLEAN_CROSSOVER
+    cache_set_clean_crossover(PREM_CLEAN_CROSSOVER);
+#endif
 #endif
 
 // Only set handlers iff they are defined before
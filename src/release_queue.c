@@ -0,0 +1,171 @@
+#include <release_queue.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <generic_timer.h>
+
+// Min-heap of waiting releases, the earliest release is the first one (static until it grows)
+struct release *static_release_heap[RELEASE_QUEUE_SIZE];
+struct release **release_heap = static_release_heap;
+uint32_t release_heap_size = RELEASE_QUEUE_SIZE;
+uint32_t release_number = 0;
+
+void release_heap_swap(uint32_t first_index, uint32_t second_index)
+{
+    struct release *release = release_heap[first_index];
+    release_heap[first_index] = release_heap[second_index];
+    release_heap[second_index] = release;
+}
+
+void release_heap_sift_up(uint32_t index)
+{
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+        if (release_heap[parent]->release_time <= release_heap[index]->release_time)
+        {
+            break;
+        }
+
+        release_heap_swap(parent, index);
+        index = parent;
+    }
+}
+
+void release_heap_sift_down(uint32_t index)
+{
+    while (1)
+    {
+        uint32_t smallest = index;
+        uint32_t left = 2 * index + 1;
+        uint32_t right = left + 1;
+
+        if (left < release_number && release_heap[left]->release_time < release_heap[smallest]->release_time)
+        {
+            smallest = left;
+        }
+        if (right < release_number && release_heap[right]->release_time < release_heap[smallest]->release_time)
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+
+        release_heap_swap(smallest, index);
+        index = smallest;
+    }
+}
+
+/* Removes the release at [index], the last one takes its place */
+void release_heap_remove(uint32_t index)
+{
+    release_number--;
+    if (index != release_number)
+    {
+        release_heap[index] = release_heap[release_number];
+        release_heap_sift_up(index);
+        release_heap_sift_down(index);
+    }
+}
+
+/* Arms the release deadline at the earliest release. Interrupts must be masked */
+void release_queue_arm(void)
+{
+    if (release_number != 0)
+    {
+        generic_timer_set_deadline(GENERIC_TIMER_DEADLINE_RELEASE, release_heap[0]->release_time);
+    }
+    else
+    {
+        generic_timer_cancel_deadline(GENERIC_TIMER_DEADLINE_RELEASE);
+    }
+}
+
+/* Physical timer deadline, wakes up all the tasks whose release time is reached */
+void release_handler(void)
+{
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    uint64_t current_time = generic_timer_read_counter();
+
+    while (release_number != 0 && release_heap[0]->release_time <= current_time)
+    {
+        // Remove it before waking the task up, the release can be on its stack
+        struct release *release = release_heap[0];
+        release_heap_remove(0);
+        vTaskNotifyGiveIndexedFromISR(release->task, RELEASE_QUEUE_NOTIFICATION, &higher_priority_task_woken);
+    }
+
+    release_queue_arm();
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+void release_queue_init(void)
+{
+    generic_timer_set_deadline_handler(GENERIC_TIMER_DEADLINE_RELEASE, release_handler);
+}
+
+void release_queue_wait(struct release *release)
+{
+    release->task = xTaskGetCurrentTaskHandle();
+
+    taskENTER_CRITICAL();
+    configASSERT(release_number < release_heap_size);
+    release_heap[release_number] = release;
+    release_heap_sift_up(release_number++);
+    release_queue_arm();
+    taskEXIT_CRITICAL();
+
+    // If the release is already there, the notification is pending and this returns right away
+    ulTaskNotifyTakeIndexed(RELEASE_QUEUE_NOTIFICATION, pdTRUE, portMAX_DELAY);
+}
+
+BaseType_t release_queue_reserve(uint32_t size)
+{
+    if (size <= release_heap_size)
+    {
+        return pdPASS;
+    }
+
+    struct release **new_heap = (struct release **)pvPortMalloc(sizeof(struct release *) * size);
+    if (new_heap == NULL)
+    {
+        return pdFAIL;
+    }
+
+    // The release handler uses the heap, copy and switch with interrupts masked
+    UBaseType_t interrupt_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    struct release **old_heap = release_heap;
+    for (uint32_t index = 0; index < release_number; index++)
+    {
+        new_heap[index] = old_heap[index];
+    }
+    release_heap = new_heap;
+    release_heap_size = size;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(interrupt_mask);
+
+    if (old_heap != static_release_heap)
+    {
+        vPortFree(old_heap);
+    }
+
+    return pdPASS;
+}
+
+void release_queue_remove_task(void *task)
+{
+    UBaseType_t interrupt_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    // A task waits for one release at a time
+    for (uint32_t index = 0; index < release_number; index++)
+    {
+        if (release_heap[index]->task == (TaskHandle_t)task)
+        {
+            release_heap_remove(index);
+            release_queue_arm();
+            break;
+        }
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(interrupt_mask);
+}
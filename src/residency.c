@@ -0,0 +1,158 @@
+#include <residency.h>
+#include <cache.h>
+#include <color.h>
+
+/* A range in the L2 (end excluded) */
+struct residency_entry
+{
+    uint64_t start;
+    uint64_t end;
+};
+
+struct residency_entry residency_entries[RESIDENCY_MAX_ENTRIES];
+uint64_t residency_entry_number = 0;
+uint64_t residency_generation = 0;
+
+// Maximum number of lines used in one set by all the ranges
+uint64_t residency_used_ways = 0;
+
+/*
+ * Maximum number of lines that a range of [size] bytes puts in the same L2 set. The
+ * VM only has RESIDENCY_VM_COLORS colors, so its data only goes in that fraction of
+ * the sets. A line more is counted for ranges that are not line aligned.
+ */
+uint64_t get_range_ways(const struct cache_level *l2, uint64_t size)
+{
+    uint64_t color_number = color_get_number();
+    uint64_t vm_colors = RESIDENCY_VM_COLORS < color_number ? RESIDENCY_VM_COLORS : color_number;
+    uint64_t way_size = l2->sets * l2->line_size * vm_colors / color_number;
+    return (size + l2->line_size + way_size - 1) / way_size;
+}
+
+/* Number of ways that ranges can use, the other ones are for the computation itself */
+uint64_t get_way_budget(const struct cache_level *l2)
+{
+    return l2->ways > RESIDENCY_RESERVED_WAYS ? l2->ways - RESIDENCY_RESERVED_WAYS : 0;
+}
+
+void residency_invalidate_all(void)
+{
+    residency_entry_number = 0;
+    residency_used_ways = 0;
+    residency_generation++;
+}
+
+void residency_invalidate_range(uint64_t address, uint64_t size)
+{
+    uint64_t end = address + size;
+    uint64_t index = 0;
+
+    // Remove overlapping entries by replacing them with the last one (used ways are kept, it is an upper bound)
+    while (index < residency_entry_number)
+    {
+        struct residency_entry *entry = &residency_entries[index];
+        if (entry->start < end && address < entry->end)
+        {
+            *entry = residency_entries[--residency_entry_number];
+        }
+        else
+        {
+            index++;
+        }
+    }
+
+    if (residency_entry_number == 0)
+    {
+        residency_used_ways = 0;
+    }
+}
+
+uint64_t residency_get_ways(uint64_t size)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+    if (size == 0 || l2 == NULL)
+    {
+        return 0;
+    }
+
+    return get_range_ways(l2, size);
+}
+
+uint8_t residency_can_load(uint64_t ways, uint64_t range_number)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+    if (l2 == NULL)
+    {
+        return 0;
+    }
+
+    return residency_used_ways + ways <= get_way_budget(l2) && residency_entry_number + range_number <= RESIDENCY_MAX_ENTRIES;
+}
+
+uint64_t residency_get_generation(void)
+{
+    return residency_generation;
+}
+
+void residency_mark_loaded(uint64_t address, uint64_t size, uint64_t generation)
+{
+    const struct cache_level *l2 = cache_get_level(2);
+
+    // Nothing to record or something was evicted while loading
+    if (size == 0 || l2 == NULL || generation != residency_generation)
+    {
+        return;
+    }
+
+    // Too big to be kept at all
+    uint64_t ways = get_range_ways(l2, size);
+    uint64_t way_budget = get_way_budget(l2);
+    if (ways > way_budget)
+    {
+        residency_invalidate_all();
+        return;
+    }
+
+    // If it can evict something (or there is no place), forget everything
+    if (residency_used_ways + ways > way_budget || residency_entry_number == RESIDENCY_MAX_ENTRIES)
+    {
+        residency_invalidate_all();
+    }
+
+    residency_entries[residency_entry_number].start = address;
+    residency_entries[residency_entry_number].end = address + size;
+    residency_entry_number++;
+    residency_used_ways += ways;
+}
+
+uint64_t residency_get_missing(uint64_t address, uint64_t size, uint64_t *missing_address)
+{
+    uint64_t end = address + size;
+    uint8_t shrunk = 1;
+
+    // Shrink until no entry covers the start or the end (entries are not sorted)
+    while (shrunk && address < end)
+    {
+        shrunk = 0;
+        for (uint64_t index = 0; index < residency_entry_number && address < end; index++)
+        {
+            const struct residency_entry *entry = &residency_entries[index];
+
+            // Entry covers the start, skip it
+            if (entry->start <= address && address < entry->end)
+            {
+                address = entry->end < end ? entry->end : end;
+                shrunk = 1;
+            }
+            // Entry covers the end, stop before
+            else if (entry->start < end && end <= entry->end)
+            {
+                end = entry->start;
+                shrunk = 1;
+            }
+        }
+    }
+
+    *missing_address = address;
+    return address < end ? end - address : 0;
+}
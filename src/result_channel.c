@@ -0,0 +1,159 @@
+#include <result_channel.h>
+#include <FreeRTOS.h>
+#include <generic_timer.h>
+
+// Only compiled when the result channel is used (RESULT_CHANNEL=shmem or semihosting)
+#ifdef RESULT_CHANNEL
+#if (RESULT_CHANNEL_CAPACITY & (RESULT_CHANNEL_CAPACITY - 1)) != 0
+#error RESULT_CHANNEL_CAPACITY must be a power of 2
+#endif
+
+#ifdef RESULT_CHANNEL_ADDRESS
+// Channel in the shared memory region
+struct result_channel_header *const channel_header = (struct result_channel_header *)(RESULT_CHANNEL_ADDRESS);
+#else
+// Channel in the guest memory
+uint8_t result_channel_buffer[sizeof(struct result_channel_header) + sizeof(struct result_record) * RESULT_CHANNEL_CAPACITY] __attribute__((aligned(64)));
+struct result_channel_header *const channel_header = (struct result_channel_header *)result_channel_buffer;
+#endif
+
+struct result_record *const channel_records = (struct result_record *)(channel_header + 1);
+uint64_t stream_number = 0;
+
+#ifdef RESULT_CHANNEL_SEMIHOSTING
+/* Semihosting operations and open mode */
+#define SEMIHOSTING_SYS_OPEN 0x01
+#define SEMIHOSTING_SYS_WRITE 0x05
+#define SEMIHOSTING_MODE_WB 5
+
+int64_t result_file = -1;
+
+uint64_t semihosting_call(uint64_t operation, uint64_t *parameters)
+{
+    register uint64_t x0 __asm__("x0") = operation;
+    register uint64_t x1 __asm__("x1") = (uint64_t)parameters;
+
+    __asm__ volatile("hlt #0xf000" : "+r"(x0) : "r"(x1) : "memory");
+
+    return x0;
+}
+
+void semihosting_write(void *buffer, uint64_t size)
+{
+    uint64_t parameters[3] = {(uint64_t)result_file, (uint64_t)buffer, size};
+    semihosting_call(SEMIHOSTING_SYS_WRITE, parameters);
+}
+#endif
+
+void result_channel_init(void)
+{
+    channel_header->magic = RESULT_CHANNEL_MAGIC;
+    channel_header->version = RESULT_CHANNEL_VERSION;
+    channel_header->frequency = generic_timer_get_freq();
+    channel_header->capacity = RESULT_CHANNEL_CAPACITY;
+    channel_header->write_index = 0;
+    channel_header->read_index = 0;
+    channel_header->dropped = 0;
+
+#ifdef RESULT_CHANNEL_SEMIHOSTING
+    char *file_name = RESULT_CHANNEL_FILE;
+    uint64_t parameters[3] = {(uint64_t)file_name, SEMIHOSTING_MODE_WB, sizeof(RESULT_CHANNEL_FILE) - 1};
+    result_file = semihosting_call(SEMIHOSTING_SYS_OPEN, parameters);
+#endif
+}
+
+uint64_t result_channel_open(const char *name)
+{
+    // First stream, init channel
+    if (stream_number == 0)
+    {
+        result_channel_init();
+    }
+
+    uint64_t stream = stream_number++;
+
+    // Write the name 8 characters at a time (little endian), until the end of string is written
+    uint8_t end_of_name = 0;
+    while (!end_of_name)
+    {
+        uint64_t characters = 0;
+        for (int index = 0; index < 8 && !end_of_name; index++)
+        {
+            if (*name == '\0')
+            {
+                end_of_name = 1;
+            }
+            else
+            {
+                characters |= (uint64_t)(uint8_t)*name++ << (8 * index);
+            }
+        }
+
+        result_channel_write(RESULT_CHANNEL_NAME_RECORD | stream, characters);
+    }
+
+    return stream;
+}
+
+void result_channel_write(uint64_t stream, uint64_t value)
+{
+    uint64_t write_index = channel_header->write_index;
+
+    // Full, do not wait for the reader
+    if (write_index - channel_header->read_index >= RESULT_CHANNEL_CAPACITY)
+    {
+        channel_header->dropped += 1;
+        return;
+    }
+
+    struct result_record *record = &channel_records[write_index & (RESULT_CHANNEL_CAPACITY - 1)];
+    record->stream = stream;
+    record->value = value;
+
+    // Record must be visible before the index
+    __asm__ volatile("dmb ishst" ::: "memory");
+    channel_header->write_index = write_index + 1;
+}
+
+uint64_t result_channel_pending(void)
+{
+    return channel_header->write_index - channel_header->read_index;
+}
+
+void result_channel_drain(void)
+{
+#ifdef RESULT_CHANNEL_SEMIHOSTING
+    if (result_file < 0)
+    {
+        return;
+    }
+
+    uint64_t read_index = channel_header->read_index;
+    uint64_t write_index = channel_header->write_index;
+    if (read_index == write_index)
+    {
+        return;
+    }
+
+    // Header of the block, capacity of 0 means that records follow
+    struct result_channel_header block_header = *channel_header;
+    block_header.capacity = 0;
+    block_header.read_index = read_index;
+    block_header.write_index = write_index;
+    semihosting_write(&block_header, sizeof(struct result_channel_header));
+
+    // Records can be in two parts if the ring buffer wrapped
+    uint64_t first = read_index & (RESULT_CHANNEL_CAPACITY - 1);
+    uint64_t count = write_index - read_index;
+    if (first + count > RESULT_CHANNEL_CAPACITY)
+    {
+        semihosting_write(&channel_records[first], (RESULT_CHANNEL_CAPACITY - first) * sizeof(struct result_record));
+        count -= RESULT_CHANNEL_CAPACITY - first;
+        first = 0;
+    }
+    semihosting_write(&channel_records[first], count * sizeof(struct result_record));
+
+    channel_header->read_index = write_index;
+#endif
+}
+#endif
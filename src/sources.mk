@@ -1,2 +1,2 @@
-src_c_srcs:= main.c hypervisor.c state_machine.c periodic_task.c prem_task.c benchmark.c generic_timer.c
+src_c_srcs:= main.c hypervisor.c state_machine.c periodic_task.c prem_task.c benchmark.c generic_timer.c histogram.c result_channel.c pmu.c cache.c residency.c color.c calibration.c release_queue.c
 src_s_srcs:= prefetch.S
\ No newline at end of file
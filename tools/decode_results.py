@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Decodes the binary result channel (see src/inc/result_channel.h) and prints the
+results in the same format as the benchmarks print them on the UART.
+
+The input is either the semihosting file (results.bin) or a dump of the shared
+memory region.
+
+The unit of each stream comes from its name, like the C side names them
+(cf. benchmark_ctx_init): streams ending in _ns are in ns, the other ones
+(ending in _us or without unit) are in us.
+
+Usage: decode_results.py <file>
+"""
+import struct
+import sys
+
+RESULT_CHANNEL_MAGIC = 0x4D455250
+RESULT_CHANNEL_VERSION = 1
+RESULT_CHANNEL_NAME_RECORD = 1 << 63
+
+# magic, version, frequency, capacity, write_index, read_index, dropped
+HEADER_FORMAT = '<IIQQQQQ'
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+RECORD_FORMAT = '<QQ'
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+
+def read_header(data, offset):
+    magic, version, frequency, capacity, write_index, read_index, dropped = struct.unpack_from(HEADER_FORMAT, data, offset)
+    if magic != RESULT_CHANNEL_MAGIC or version != RESULT_CHANNEL_VERSION:
+        raise ValueError(f'Bad channel header at offset {offset}')
+    return frequency, capacity, write_index, read_index, dropped
+
+
+def read_records(data):
+    """Returns the frequency, the number of dropped records and all records"""
+    frequency, capacity, write_index, read_index, dropped = read_header(data, 0)
+    records = []
+
+    # Shared memory dump: one header and the ring buffer
+    if capacity != 0:
+        for index in range(read_index, write_index):
+            records.append(struct.unpack_from(RECORD_FORMAT, data, HEADER_SIZE + (index % capacity) * RECORD_SIZE))
+        return frequency, dropped, records
+
+    # Semihosting file: blocks of header + records
+    offset = 0
+    while offset < len(data):
+        frequency, _, write_index, read_index, dropped = read_header(data, offset)
+        offset += HEADER_SIZE
+        for _ in range(write_index - read_index):
+            records.append(struct.unpack_from(RECORD_FORMAT, data, offset))
+            offset += RECORD_SIZE
+
+    return frequency, dropped, records
+
+
+def decode_streams(records):
+    """Returns the list of (name, values) in stream order"""
+    names = {}
+    values = {}
+    for stream, value in records:
+        if stream & RESULT_CHANNEL_NAME_RECORD:
+            stream &= ~RESULT_CHANNEL_NAME_RECORD
+            names[stream] = names.get(stream, b'') + value.to_bytes(8, 'little').rstrip(b'\0')
+            values.setdefault(stream, [])
+        else:
+            values.setdefault(stream, []).append(value)
+
+    return [(names.get(stream, b'stream%d' % stream).decode(), values[stream]) for stream in sorted(values)]
+
+
+def stream_unit(name):
+    """Returns the (divider, unit) of the stream, from the suffix of its name"""
+    if name.endswith('_ns'):
+        return 1000000000, 'ns'
+    return 1000000, 'us'
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as file:
+        data = file.read()
+
+    frequency, dropped, records = read_records(data)
+
+    if dropped != 0:
+        print(f'# {dropped} records were dropped (channel full)')
+
+    for name, values in decode_streams(records):
+        divider, unit = stream_unit(name)
+        times = [value * divider // frequency for value in values]
+        suffix = name[len('elapsed_time_array'):] if name.startswith('elapsed_time_array') else '_' + name
+        print(f'{name} = [{",".join(str(time) for time in times)},]')
+        if times:
+            print(f'min{suffix} = {min(times)} # {unit}')
+            print(f'max{suffix} = {max(times)} # {unit}')
+            print(f'int_average{suffix} = {sum(times) // len(times)} # {unit}')
+        print()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Chooses release offsets for a PREM taskset so that memory phases are spread over
+the hyperperiod (see tickOffset in src/inc/periodic_task.h and src/inc/prem_task.h).
+
+The taskset is a JSON file with one entry per task, times are in FreeRTOS ticks
+(configTICK_RATE_HZ, 3000 by default, so pdMS_TO_TICKS(45) is 135):
+
+    {"tasks": [
+        {"name": "MPEG2", "core": 0, "period": 135, "memory": 6},
+        {"name": "Weight average", "core": 0, "period": 150, "memory": 9},
+        ...
+    ]}
+
+"memory" is the length of the memory phase (prefetch time, rounded up to ticks),
+"core" is the core of the task. Tasks on different cores compete for the memory
+token, so overlapping memory phases of different cores cost a ttw. Overlaps on the
+same core are only counted with --same-core (the core serialises them anyway).
+
+The cost is the total time where two memory phases overlap (summed over pairs).
+Offsets are found by coordinate descent: each task takes the offset in [0, period[
+that minimises the cost given the other ones, until nothing changes, with random
+restarts. Releases are aligned on the hyperperiod on each core (call
+vPeriodicSetStartAlignment with it) so that offsets of all cores are relative to
+the same instant.
+
+Usage: optimize_offsets.py <taskset.json> [--restarts N] [--seed S] [--same-core]
+"""
+import json
+import math
+import random
+import sys
+
+
+def hyperperiod(tasks):
+    result = 1
+    for task in tasks:
+        result = result * task['period'] // math.gcd(result, task['period'])
+    return result
+
+
+def task_slots(task, offset, length):
+    """Returns the (start, end) memory phase intervals of the task in [0 ; length["""
+    intervals = []
+    for release in range(offset, offset + length, task['period']):
+        start = release % length
+        end = start + task['memory']
+        if end <= length:
+            intervals.append((start, end))
+        else:
+            intervals.append((start, length))
+            intervals.append((0, end - length))
+    return intervals
+
+
+def add_task(counts, task, offset, value):
+    for start, end in task_slots(task, offset, len(counts)):
+        for slot in range(start, end):
+            counts[slot] += value
+
+
+def competing_counts(tasks, offsets, index, length, same_core):
+    """Number of memory phases competing with task [index] in each slot"""
+    counts = [0] * length
+    for other, task in enumerate(tasks):
+        if other != index and (same_core or task['core'] != tasks[index]['core']):
+            add_task(counts, task, offsets[other], 1)
+    return counts
+
+
+def best_offset(tasks, offsets, index, length, same_core):
+    """Offset of task [index] with the lowest overlap with the other tasks"""
+    counts = competing_counts(tasks, offsets, index, length, same_core)
+
+    # Prefix sums over two hyperperiods, so phases that wrap are one interval
+    prefix = [0]
+    for slot in range(2 * length):
+        prefix.append(prefix[-1] + counts[slot % length])
+
+    task = tasks[index]
+    best, best_cost = offsets[index], None
+    for offset in range(task['period']):
+        cost = 0
+        for release in range(offset, length, task['period']):
+            cost += prefix[release + task['memory']] - prefix[release]
+        if best_cost is None or cost < best_cost:
+            best, best_cost = offset, cost
+    return best
+
+
+def overlap_cost(tasks, offsets, length, same_core):
+    """Total time where two memory phases overlap, and the worst number of phases at once"""
+    cost = 0
+    for index in range(len(tasks)):
+        counts = competing_counts(tasks, offsets, index, length, same_core)
+        for start, end in task_slots(tasks[index], offsets[index], length):
+            cost += sum(counts[start:end])
+
+    counts = [0] * length
+    for index, task in enumerate(tasks):
+        add_task(counts, task, offsets[index], 1)
+    return cost // 2, max(counts)
+
+
+def optimize(tasks, length, restarts, same_core, generator):
+    best_offsets = [0] * len(tasks)
+    best_cost = overlap_cost(tasks, best_offsets, length, same_core)
+
+    for restart in range(restarts):
+        # First try from 0, then from random offsets
+        offsets = [0 if restart == 0 else generator.randrange(task['period']) for task in tasks]
+        changed = True
+        while changed:
+            changed = False
+            for index in range(len(tasks)):
+                offset = best_offset(tasks, offsets, index, length, same_core)
+                if offset != offsets[index]:
+                    previous = offsets[index]
+                    previous_cost = overlap_cost(tasks, offsets, length, same_core)
+                    offsets[index] = offset
+                    if overlap_cost(tasks, offsets, length, same_core) < previous_cost:
+                        changed = True
+                    else:
+                        offsets[index] = previous
+
+        cost = overlap_cost(tasks, offsets, length, same_core)
+        if cost < best_cost:
+            best_offsets, best_cost = offsets, cost
+
+    return best_offsets, best_cost
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    restarts = int(sys.argv[sys.argv.index('--restarts') + 1]) if '--restarts' in sys.argv else 10
+    seed = int(sys.argv[sys.argv.index('--seed') + 1]) if '--seed' in sys.argv else 0
+    same_core = '--same-core' in sys.argv
+
+    with open(sys.argv[1]) as file:
+        tasks = json.load(file)['tasks']
+
+    for task in tasks:
+        if task['memory'] > task['period']:
+            raise ValueError(f'Memory phase of {task["name"]} is longer than its period')
+
+    length = hyperperiod(tasks)
+    initial_cost = overlap_cost(tasks, [0] * len(tasks), length, same_core)
+    offsets, cost = optimize(tasks, length, restarts, same_core, random.Random(seed))
+
+    print(f'# Hyperperiod: {length} ticks (vPeriodicSetStartAlignment({length}))')
+    print(f'# Overlap without offsets: {initial_cost[0]} ticks, at most {initial_cost[1]} memory phases at once')
+    print(f'# Overlap with offsets: {cost[0]} ticks, at most {cost[1]} memory phases at once')
+    for task, offset in zip(tasks, offsets):
+        print(f'core {task["core"]} {task["name"]}: .tickOffset = {offset}')
+
+
+if __name__ == '__main__':
+    main()